@@ -1,11 +1,29 @@
 #define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include "example_2_lib.h" // errno-style wrapper (TLS defined in example_2_lib.c)
 
 #define NOINLINE __attribute__((noinline))
 
+#ifdef CDK_ERROR_FLIGHT
+struct cdk_EFlight cdk_hidden_eflight = {0};
+#endif
+
+#ifdef CDK_ERROR_CAUSES
+_Thread_local struct cdk_ECauses cdk_hidden_ecauses = {0};
+#endif
+
+#ifdef CDK_ERROR_DEPTH
+_Thread_local size_t cdk_hidden_edepth = 0;
+#endif
+
+#ifdef CDK_ERROR_SAMPLE
+_Thread_local struct cdk_ESampler cdk_hidden_esampler = {0};
+#endif
+
 // — 5-level error trace (literal string) —
 static NOINLINE int err_l1(void) {
   cdk_errno = cdk_errnos(1, "Some error");
@@ -41,7 +59,7 @@ static NOINLINE int err_l5(void) {
 }
 
 // — 5-level formatted-error trace —
-#ifndef CDK_ERROR_OPTIMIZE
+#if CDK_ERROR_FSTR_ENABLE
 static NOINLINE int errf_l1(void) {
   cdk_errno = cdk_errnof(1, "Error #%d occurred", 1);
   return -1;
@@ -76,6 +94,109 @@ static NOINLINE int errf_l5(void) {
 }
 #endif
 
+// — single error construction —
+static NOINLINE cdk_error_t new_err_zeroed(uint16_t code) {
+  // Compound literal assignment, zeroes every frame and the message buffer.
+  cdk_hidden_errno = (struct cdk_Error){
+      .type = cdk_ErrorType_STR,
+      .code = code,
+      .msg = "Some error",
+      .eframes = {{CDK_EFRAME_HERE}},
+      .eframes_len = 1,
+  };
+  return &cdk_hidden_errno;
+}
+static NOINLINE cdk_error_t new_err(uint16_t code) {
+  return cdk_errnos(code, "Some error");
+}
+static NOINLINE cdk_error_t new_err_static(void) {
+  return cdk_error_statics(EAGAIN, "Some error");
+}
+#ifdef CDK_ERROR_CAUSES
+static NOINLINE cdk_error_t new_err_chained(uint16_t code) {
+  // Previous iteration's error becomes the cause.
+  return cdk_errno = cdk_errnocs(code, "Some error");
+}
+#endif
+
+// Bytes of the thread's slot a constructor writes, found by running it over
+// two fill patterns, so every mode's extra fields are counted.
+static size_t bytes_written(cdk_error_t (*create)(uint16_t)) {
+  unsigned char pass[2][sizeof(struct cdk_Error)];
+  const unsigned char fill[2] = {0xa5, 0x5a};
+  size_t written = 0;
+
+  for (int p = 0; p < 2; p++) {
+    memset(&cdk_hidden_errno, fill[p], sizeof(cdk_hidden_errno));
+    create(1);
+    memcpy(pass[p], &cdk_hidden_errno, sizeof(cdk_hidden_errno));
+  }
+  for (size_t i = 0; i < sizeof(struct cdk_Error); i++) {
+    written += pass[0][i] != fill[0] || pass[1][i] != fill[1];
+  }
+
+  return written;
+}
+
+// — text dump through stdio, as cdk_error_dumps did before cdk_EWriter —
+static NOINLINE int dumps_stdio(cdk_error_t err, size_t buf_size, char *buf) {
+  size_t offset = 0;
+  int written;
+
+  written = snprintf(buf, buf_size,
+                     "====== ERROR DUMP ======\n"
+                     "Error code: %d\n"
+                     "Error desc: %s\n",
+                     err->code, strerror(err->code));
+  if (written < 0 || (size_t)written >= buf_size) {
+    return ENOBUFS;
+  }
+  offset += written;
+
+  if (err->type > cdk_ErrorType_INT) {
+    written =
+        snprintf(buf + offset, buf_size - offset, "------------------------\n");
+    if (written < 0 || (size_t)written >= buf_size - offset) {
+      return ENOBUFS;
+    }
+    offset += written;
+  }
+
+  if (err->type == cdk_ErrorType_STR) {
+    written =
+        snprintf(buf + offset, buf_size - offset, " Error msg: %s\n", err->msg);
+    if (written < 0 || (size_t)written >= buf_size - offset) {
+      return ENOBUFS;
+    }
+    offset += written;
+  }
+
+  written =
+      snprintf(buf + offset, buf_size - offset, "------------------------\n");
+  if (written < 0 || (size_t)written >= buf_size - offset) {
+    return ENOBUFS;
+  }
+  offset += written;
+
+  written = snprintf(buf + offset, buf_size - offset, " Backtrace:\n");
+  if (written < 0 || (size_t)written >= buf_size - offset) {
+    return ENOBUFS;
+  }
+  offset += written;
+
+  for (size_t i = 0; i < err->eframes_len; i++) {
+    struct cdk_ESite site = cdk_eframe_site(&err->eframes[i]);
+    written = snprintf(buf + offset, buf_size - offset, "   [%02zu] %s:%s:%d\n",
+                       i, site.file, site.func, site.line);
+    if (written < 0 || (size_t)written >= buf_size - offset) {
+      return ENOBUFS;
+    }
+    offset += written;
+  }
+
+  return 0;
+}
+
 // — 5-level plain int return —
 static volatile int __i__ = 0;
 static NOINLINE int int_l1(void) { return __i__++; }
@@ -93,8 +214,22 @@ int main(void) {
   const int iters = 1000000;
   struct timespec t0, t1;
   double ns_err = 0.0, ns_fmt = 0.0, ns_int = 0.0;
+  double ns_new_zeroed = 0.0, ns_new = 0.0, ns_new_static = 0.0;
+  double ns_new_chained = 0.0;
+  double ns_sampled[3] = {0};
+  const uint32_t sample_every[3] = {100, 10, 1};
+  double ns_dumps_stdio = 0.0, ns_dumps = 0.0;
+  char dump_stdio[2048], dump[2048];
   volatile int sink = 0;
 
+#ifdef CDK_ERROR_FLIGHT
+  // every created error below is mirrored into the mapped file
+  if (cdk_error_flight_open("bench_flight.bin", 4096)) {
+    perror("cdk_error_flight_open");
+    return 1;
+  }
+#endif
+
   // measure unformatted errno-trace
   cdk_errno = 0;
   clock_gettime(CLOCK_MONOTONIC, &t0);
@@ -105,7 +240,23 @@ int main(void) {
   clock_gettime(CLOCK_MONOTONIC, &t1);
   ns_err = ns_since(&t0, &t1);
 
-#ifndef CDK_ERROR_OPTIMIZE
+#ifdef CDK_ERROR_SAMPLE
+  // measure unformatted errno-trace with 1%, 10% and 100% of errors traced
+  for (int s = 0; s < 3; s++) {
+    cdk_error_sample_every(sample_every[s]);
+    cdk_errno = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+      sink ^= err_l5();
+      cdk_errno = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_sampled[s] = ns_since(&t0, &t1);
+  }
+  cdk_error_sample_every(0);
+#endif
+
+#if CDK_ERROR_FSTR_ENABLE
   // measure formatted errno-trace
   cdk_errno = 0;
   clock_gettime(CLOCK_MONOTONIC, &t0);
@@ -117,6 +268,54 @@ int main(void) {
   ns_fmt = ns_since(&t0, &t1);
 #endif
 
+  // measure single error construction, zeroed vs field-wise
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= new_err_zeroed(i)->code;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_new_zeroed = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= new_err(i)->code;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_new = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= new_err_static()->code;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_new_static = ns_since(&t0, &t1);
+
+#ifdef CDK_ERROR_CAUSES
+  cdk_errno = new_err(0);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= new_err_chained(i)->code;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_new_chained = ns_since(&t0, &t1);
+#endif
+
+  // measure text dump of a 5-level trace, stdio vs cdk_EWriter
+  err_l5();
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= dumps_stdio(&cdk_hidden_errno, sizeof(dump_stdio), dump_stdio);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_dumps_stdio = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= cdk_edumps(sizeof(dump), dump);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_dumps = ns_since(&t0, &t1);
+
   // measure plain int return
   clock_gettime(CLOCK_MONOTONIC, &t0);
   for (int i = 0; i < iters; i++) {
@@ -125,16 +324,48 @@ int main(void) {
   clock_gettime(CLOCK_MONOTONIC, &t1);
   ns_int = ns_since(&t0, &t1);
 
+  printf("profile: btrace %s, fstr %s, frame %s, %zu bytes per error\n",
+         CDK_ERROR_BTRACE_ENABLE ? "on" : "off",
+         CDK_ERROR_FSTR_ENABLE ? "on" : "off",
+         CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE   ? "line"
+         : CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC ? "func+line"
+                                                   : "full",
+         sizeof(struct cdk_Error));
   printf("5-lvl errno-trace avg:     %.1f ns\n", ns_err / iters);
-#ifndef CDK_ERROR_OPTIMIZE
+#ifdef CDK_ERROR_SAMPLE
+  for (int s = 0; s < 3; s++) {
+    printf("5-lvl sampled %3u%% avg:    %.1f ns\n", 100 / sample_every[s],
+           ns_sampled[s] / iters);
+  }
+#endif
+#if CDK_ERROR_FSTR_ENABLE
   printf("5-lvl fmt errno-trace avg: %.1f ns\n", ns_fmt / iters);
 #else
-  printf("5-lvl fmt errno-trace avg: (disabled by CDK_ERROR_OPTIMIZE)\n");
+  printf("5-lvl fmt errno-trace avg: (disabled by CDK_ERROR_FSTR_ENABLE)\n");
 #endif
   printf("5-lvl int           avg:   %.1f ns\n", ns_int / iters);
+  printf("create zero-init    avg:   %.1f ns (%zu bytes written)\n",
+         ns_new_zeroed / iters, bytes_written(new_err_zeroed));
+  printf("create field-init   avg:   %.1f ns (%zu bytes written)\n",
+         ns_new / iters, bytes_written(new_err));
+  printf("create static       avg:   %.1f ns (0 bytes written)\n",
+         ns_new_static / iters);
+#ifdef CDK_ERROR_CAUSES
+  printf("create chained      avg:   %.1f ns\n", ns_new_chained / iters);
+#endif
+  printf("dumps stdio         avg:   %.1f ns\n", ns_dumps_stdio / iters);
+  printf("dumps writer        avg:   %.1f ns (%s)\n", ns_dumps / iters,
+         strcmp(dump_stdio, dump) ? "output differs" : "identical output");
+
+#ifdef CDK_ERROR_FLIGHT
+  cdk_error_flight_close();
+#endif
 
   (void)sink; // keep side effects
   (void)ns_fmt;
+  (void)ns_new_chained;
+  (void)ns_sampled;
+  (void)sample_every;
 
   return 0;
 }
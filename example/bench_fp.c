@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "example_2_lib.h" // errno-style wrapper (TLS defined in example_2_lib.c)
+
+#define NOINLINE __attribute__((noinline))
+
+#ifdef CDK_ERROR_FRAME_POINTERS
+struct cdk_ESymCache cdk_hidden_esymcache = {0};
+
+// Frame pointers find the callers, propagation is a plain return.
+#define PROPAGATE(ret) (ret)
+#else
+#define PROPAGATE(ret) cdk_ereturn(ret)
+#endif
+
+// — error created `depth` calls below the measuring loop —
+static NOINLINE int fail_at(int depth) {
+  if (depth == 0) {
+    cdk_errno = cdk_errnoi(EIO);
+    return -1;
+  }
+
+  int ret = fail_at(depth - 1);
+  __asm__ volatile("" ::: "memory"); // keep each level's frame
+  if (ret < 0) {
+    return PROPAGATE(-1);
+  }
+  return ret;
+}
+
+static inline double ns_since(const struct timespec *a,
+                              const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+int main(void) {
+  const int iters = 1000000;
+  const int depths[] = {1, 4, 8, 16, 24};
+  struct timespec t0, t1;
+  volatile int sink = 0;
+
+#ifdef CDK_ERROR_FRAME_POINTERS
+  printf("backtrace: frame pointers, up to %d return addresses\n",
+         CDK_ERROR_FP_MAX);
+#else
+  printf("backtrace: manual, cdk_ereturn at every level\n");
+#endif
+
+  for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+      sink ^= fail_at(depths[d]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("depth %2d error avg:  %.1f ns\n", depths[d],
+           ns_since(&t0, &t1) / iters);
+  }
+
+#ifdef CDK_ERROR_FRAME_POINTERS
+  // measure dump of a 16 deep error, first with empty symbol cache
+  char dump[8192];
+  double ns_cold, ns_cached;
+
+  fail_at(16);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  sink ^= cdk_edumps(sizeof(dump), dump);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_cold = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters / 100; i++) {
+    sink ^= cdk_edumps(sizeof(dump), dump);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_cached = ns_since(&t0, &t1) / (iters / 100);
+
+  printf("dumps, empty cache:  %.1f ns\n", ns_cold);
+  printf("dumps cached    avg: %.1f ns\n", ns_cached);
+#endif
+
+  (void)sink; // keep side effects
+
+  return 0;
+}
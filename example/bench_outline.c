@@ -0,0 +1,142 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "example_2_lib.h" // errno-style wrapper (TLS defined in example_2_lib.c)
+
+#define NOINLINE __attribute__((noinline))
+
+#define SITES 16
+
+// — the same hot function with and without error sites, each in own section
+//   so its size can be read from the linker generated bounds —
+#define HOT_FN(name, section_name)                                             \
+  extern const char __start_##section_name[];                                  \
+  extern const char __stop_##section_name[];                                   \
+  static NOINLINE __attribute__((section(#section_name))) int name(            \
+      const int *in)
+
+#define HOT_SIZE(section_name)                                                 \
+  ((size_t)(__stop_##section_name - __start_##section_name))
+
+#define STEP(i) sum += in[i];
+
+// One site per line, so sites differ and are not merged by the compiler.
+#define STEP_CHECKED(i)                                                        \
+  if (in[i] < 0) {                                                             \
+    cdk_errno = cdk_errnoi(EINVAL);                                            \
+    return cdk_ereturn(-1);                                                    \
+  }                                                                            \
+  sum += in[i];
+
+HOT_FN(hot_plain, bench_hot_plain) {
+  int sum = 0;
+  STEP(0) STEP(1) STEP(2) STEP(3) STEP(4) STEP(5) STEP(6) STEP(7)
+  STEP(8) STEP(9) STEP(10) STEP(11) STEP(12) STEP(13) STEP(14) STEP(15)
+  return sum;
+}
+
+HOT_FN(hot_checked, bench_hot_checked) {
+  int sum = 0;
+  STEP_CHECKED(0)
+  STEP_CHECKED(1)
+  STEP_CHECKED(2)
+  STEP_CHECKED(3)
+  STEP_CHECKED(4)
+  STEP_CHECKED(5)
+  STEP_CHECKED(6)
+  STEP_CHECKED(7)
+  STEP_CHECKED(8)
+  STEP_CHECKED(9)
+  STEP_CHECKED(10)
+  STEP_CHECKED(11)
+  STEP_CHECKED(12)
+  STEP_CHECKED(13)
+  STEP_CHECKED(14)
+  STEP_CHECKED(15)
+  return sum;
+}
+
+// — 5-level CDK_TRY chain which never fails —
+static NOINLINE int ok_l1(int x) {
+  if (x < 0) {
+    cdk_errno = cdk_errnoi(EINVAL);
+    return cdk_ereturn(-1);
+  }
+  return x;
+}
+static NOINLINE int ok_l2(int x) {
+  x = ok_l1(x);
+  CDK_TRY(cdk_errno);
+  return x;
+error_out:
+  return -1;
+}
+static NOINLINE int ok_l3(int x) {
+  x = ok_l2(x);
+  CDK_TRY(cdk_errno);
+  return x;
+error_out:
+  return -1;
+}
+static NOINLINE int ok_l4(int x) {
+  x = ok_l3(x);
+  CDK_TRY(cdk_errno);
+  return x;
+error_out:
+  return -1;
+}
+static NOINLINE int ok_l5(int x) {
+  x = ok_l4(x);
+  CDK_TRY(cdk_errno);
+  return x;
+error_out:
+  return -1;
+}
+
+static inline double ns_since(const struct timespec *a,
+                              const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+int main(void) {
+  const int iters = 10000000;
+  struct timespec t0, t1;
+  double ns_chain, ns_hot;
+  int in[SITES] = {0};
+  volatile int sink = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= ok_l5(i);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_chain = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    in[i & (SITES - 1)] = i & 0xff;
+    sink ^= hot_checked(in);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_hot = ns_since(&t0, &t1);
+  sink ^= hot_plain(in);
+
+#ifdef CDK_ERROR_OUTLINE
+  printf("error construction: outlined (CDK_ERROR_OUTLINE)\n");
+#else
+  printf("error construction: inline\n");
+#endif
+  printf("hot fn without sites: %zu bytes\n", HOT_SIZE(bench_hot_plain));
+  printf("hot fn with %d sites: %zu bytes (%.1f bytes per site)\n", SITES,
+         HOT_SIZE(bench_hot_checked),
+         (double)(HOT_SIZE(bench_hot_checked) - HOT_SIZE(bench_hot_plain)) /
+             SITES);
+  printf("5-lvl try success avg: %.2f ns\n", ns_chain / iters);
+  printf("%d-site success avg:  %.2f ns\n", SITES, ns_hot / iters);
+
+  (void)sink; // keep side effects
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "example_2_lib.h" // errno-style wrapper (TLS defined in example_2_lib.c)
+
+#define NOINLINE __attribute__((noinline))
+
+#define STATUS_LEN 65536
+
+static int32_t status[STATUS_LEN];
+static _Alignas(8) char storage[STATUS_LEN * CDK_EBATCH_ENTRY_SIZE];
+
+// — scalar loops, as I/O layers check batched results today —
+static NOINLINE cdk_error_t first_scalar(const int32_t *st, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (st[i] < 0) {
+      return cdk_errnoi(-st[i]);
+    }
+  }
+  return NULL;
+}
+static NOINLINE cdk_error_t first_scan(const int32_t *st, size_t len) {
+  return cdk_echeck(st, len);
+}
+static NOINLINE size_t all_scalar(struct cdk_EBatch *batch, const int32_t *st,
+                                  size_t len) {
+  size_t found = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (st[i] < 0) {
+      cdk_error_batch_add(batch, i, -st[i], NULL);
+      found++;
+    }
+  }
+  return found;
+}
+static NOINLINE size_t all_scan(struct cdk_EBatch *batch, const int32_t *st,
+                                size_t len) {
+  return cdk_error_check_all(batch, st, len, 0);
+}
+
+static inline double ns_since(const struct timespec *a,
+                              const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+// Fail every status with probability per_million, deterministic. The first
+// failure is put at 1 / rate, its expected position, so the first-failure
+// loops scan as far as the rate implies.
+static void fill_status(uint32_t per_million) {
+  size_t first = per_million ? 1000000 / per_million : STATUS_LEN;
+  uint32_t seed = 12345;
+
+  for (size_t i = 0; i < STATUS_LEN; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    status[i] = i > first && (seed >> 8) % 1000000 < per_million
+                    ? -EIO
+                    : (int32_t)i;
+  }
+  if (first < STATUS_LEN) {
+    status[first] = -EIO;
+  }
+}
+
+int main(void) {
+  const int iters = 2000;
+  const uint32_t rates[] = {0, 1000, 100000};
+  struct timespec t0, t1;
+  struct cdk_EBatch batch;
+  volatile size_t sink = 0;
+
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    double ns_first_scalar, ns_first_scan, ns_all_scalar, ns_all_scan;
+
+    fill_status(rates[r]);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+      sink ^= (size_t)first_scalar(status, STATUS_LEN);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_first_scalar = ns_since(&t0, &t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+      sink ^= (size_t)first_scan(status, STATUS_LEN);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_first_scan = ns_since(&t0, &t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+      cdk_error_batch_init(&batch, storage, sizeof(storage));
+      sink ^= all_scalar(&batch, status, STATUS_LEN);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_all_scalar = ns_since(&t0, &t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < iters; i++) {
+      cdk_error_batch_init(&batch, storage, sizeof(storage));
+      sink ^= all_scan(&batch, status, STATUS_LEN);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns_all_scan = ns_since(&t0, &t1);
+
+    printf("%d statuses, %.1f%% failing, first at %zu:\n", STATUS_LEN,
+           rates[r] / 1e4, cdk_error_scan_first(status, STATUS_LEN));
+    printf("  first scalar   avg: %.1f ns\n", ns_first_scalar / iters);
+    printf("  first scan     avg: %.1f ns\n", ns_first_scan / iters);
+    printf("  all scalar     avg: %.1f ns (%zu failures)\n",
+           ns_all_scalar / iters, batch.len);
+    printf("  all scan       avg: %.1f ns\n", ns_all_scan / iters);
+  }
+
+  (void)sink; // keep side effects
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "example_2_lib.h" // errno-style wrapper (TLS defined in example_2_lib.c)
+
+#define NOINLINE __attribute__((noinline))
+
+// — 5-level error trace (literal string) —
+static NOINLINE int err_l1(void) {
+  cdk_errno = cdk_errnos(1, "Some error");
+  return -1;
+}
+static NOINLINE int err_l2(void) { return err_l1() < 0 ? cdk_ereturn(-1) : 0; }
+static NOINLINE int err_l3(void) { return err_l2() < 0 ? cdk_ereturn(-1) : 0; }
+static NOINLINE int err_l4(void) { return err_l3() < 0 ? cdk_ereturn(-1) : 0; }
+static NOINLINE int err_l5(void) { return err_l4() < 0 ? cdk_ereturn(-1) : 0; }
+
+static inline double ns_since(const struct timespec *a,
+                              const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+int main(void) {
+  const int iters = 1000000;
+  struct timespec t0, t1;
+  double ns_dumps = 0.0, ns_encode = 0.0, ns_decode = 0.0;
+  volatile size_t sink = 0;
+  char text[2048];
+  uint8_t bin[2048];
+  size_t bin_len = 0;
+  struct cdk_EDecoded dec;
+  struct cdk_EFrameView frame;
+
+  err_l5();
+
+  // measure text dump
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    cdk_edumps(sizeof(text), text);
+    sink ^= (size_t)text[i & 63];
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_dumps = ns_since(&t0, &t1);
+
+  // measure binary encode
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    cdk_eencode(sizeof(bin), bin, &bin_len);
+    sink ^= bin_len;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_encode = ns_since(&t0, &t1);
+
+  // measure binary decode, including walking all frames
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    if (cdk_error_decode(bin_len, bin, &dec)) {
+      return 1;
+    }
+    const uint8_t *pos = dec.eframes;
+    for (int j = 0; j < dec.eframes_len; j++) {
+      pos = cdk_error_decode_frame(&dec, pos, &frame);
+      sink ^= frame.line;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_decode = ns_since(&t0, &t1);
+
+  printf("dumps  avg: %.1f ns (%zu bytes)\n", ns_dumps / iters,
+         strlen(text));
+  printf("encode avg: %.1f ns (%zu bytes)\n", ns_encode / iters, bin_len);
+  printf("decode avg: %.1f ns\n", ns_decode / iters);
+
+  (void)sink; // keep side effects
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "example_2_lib.h" // errno-style wrapper (TLS defined in example_2_lib.c)
+
+#define NOINLINE __attribute__((noinline))
+
+#ifdef CDK_ERROR_SHADOW
+_Thread_local struct cdk_EShadow cdk_hidden_eshadow = {0};
+
+// Shadow stack already holds the callers, propagation is a plain return.
+#define PROPAGATE(ret) (ret)
+#else
+#define PROPAGATE(ret) cdk_ereturn(ret)
+#endif
+
+// — 5-level chain, fails when x is negative —
+static NOINLINE int l1(int x) {
+  CDK_FUNC_ENTER();
+  if (x < 0) {
+    cdk_errno = cdk_errnoi(EINVAL);
+    return -1;
+  }
+  return x;
+}
+static NOINLINE int l2(int x) {
+  CDK_FUNC_ENTER();
+  int r = l1(x);
+  if (r < 0) {
+    return PROPAGATE(-1);
+  }
+  return r;
+}
+static NOINLINE int l3(int x) {
+  CDK_FUNC_ENTER();
+  int r = l2(x);
+  if (r < 0) {
+    return PROPAGATE(-1);
+  }
+  return r;
+}
+static NOINLINE int l4(int x) {
+  CDK_FUNC_ENTER();
+  int r = l3(x);
+  if (r < 0) {
+    return PROPAGATE(-1);
+  }
+  return r;
+}
+static NOINLINE int l5(int x) {
+  CDK_FUNC_ENTER();
+  int r = l4(x);
+  if (r < 0) {
+    return PROPAGATE(-1);
+  }
+  return r;
+}
+
+static inline double ns_since(const struct timespec *a,
+                              const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+int main(void) {
+  const int iters = 10000000;
+  struct timespec t0, t1;
+  double ns_ok, ns_err;
+  volatile int sink = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= l5(i);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_ok = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= l5(-1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_err = ns_since(&t0, &t1);
+
+#ifdef CDK_ERROR_SHADOW
+  printf("backtrace: shadow stack, CDK_FUNC_ENTER in every level\n");
+#else
+  printf("backtrace: manual, cdk_ereturn at every level\n");
+#endif
+  printf("5-lvl success avg: %.2f ns (%.2f ns per call)\n", ns_ok / iters,
+         ns_ok / iters / 5);
+  printf("5-lvl error   avg: %.2f ns (%zu frames)\n", ns_err / iters,
+         (size_t)cdk_errno->eframes_len);
+
+  (void)sink; // keep side effects
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+// Exported by the bench_tls_* shared libraries, see bench_tls_lib.c.
+int bench_tls_chain(int x);
+size_t bench_tls_frames(void);
+
+static inline double ns_since(const struct timespec *a,
+                              const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+int main(void) {
+  const int iters = 10000000;
+  struct timespec t0, t1;
+  double ns_ok, ns_err;
+  volatile int sink = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= bench_tls_chain(i);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_ok = ns_since(&t0, &t1);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < iters; i++) {
+    sink ^= bench_tls_chain(-1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns_err = ns_since(&t0, &t1);
+
+  printf("tls: %s\n", BENCH_TLS_NAME);
+  printf("5-lvl success avg: %.2f ns\n", ns_ok / iters);
+  printf("5-lvl error   avg: %.2f ns (%zu frames)\n", ns_err / iters,
+         bench_tls_frames());
+
+  (void)sink; // keep side effects
+
+  return 0;
+}
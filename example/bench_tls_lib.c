@@ -0,0 +1,58 @@
+// Error chain built into bench_tls.c's shared library, so TLS accesses use
+// the access model of position independent code.
+#include "cdk_error.h"
+
+#ifdef CDK_ERROR_TLS_BLOCK
+_Thread_local struct cdk_ETls cdk_hidden_etls = {0};
+
+#ifdef CDK_ERROR_TLS_ACCESSOR
+struct cdk_ETls *cdk_etls_location(void) { return &cdk_hidden_etls; }
+#endif
+#else
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+#endif
+
+#define NOINLINE __attribute__((noinline))
+
+// — 5-level chain, fails when x is negative —
+static NOINLINE int l1(int x) {
+  if (x < 0) {
+    cdk_errno = cdk_errnoi(EINVAL);
+    return -1;
+  }
+  return x;
+}
+static NOINLINE int l2(int x) {
+  int r = l1(x);
+  if (r < 0) {
+    cdk_ewrap();
+    cdk_ewrap(); // two wraps, the accessor resolves the slots once
+    return -1;
+  }
+  return r;
+}
+static NOINLINE int l3(int x) {
+  int r = l2(x);
+  if (r < 0) {
+    return cdk_ereturn(-1);
+  }
+  return r;
+}
+static NOINLINE int l4(int x) {
+  int r = l3(x);
+  if (r < 0) {
+    return cdk_ereturn(-1);
+  }
+  return r;
+}
+
+int bench_tls_chain(int x) {
+  int r = l4(x);
+  if (r < 0) {
+    return cdk_ereturn(-1);
+  }
+  return r;
+}
+
+size_t bench_tls_frames(void) { return cdk_errno->eframes_len; }
@@ -31,12 +31,19 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <threads.h>
 
+// Dumps to a file descriptor need write(2), other platforms dump to strings.
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define CDK_EPOSIX_
+#endif
+
 //
 ////
 //////
@@ -83,11 +90,129 @@
 #ifndef CDK_DISABLE_ERRNO_API
 #endif
 
+/*
+ * Performance profile knobs, each can be set on its own:
+ *   - `CDK_ERROR_BTRACE_ENABLE` 0 keeps only the origin frame, wraps compile to
+ *     nothing,
+ *   - `CDK_ERROR_FSTR_ENABLE` 0 drops formatted messages and their buffer,
+ *   - `CDK_ERROR_FSTR_MAX` sizes the formatted message buffer,
+ *   - `CDK_ERROR_FRAME_INFO` selects what a frame holds, `CDK_EFRAME_LINE`,
+ *     `CDK_EFRAME_FUNC` (function and line) or `CDK_EFRAME_FULL`.
+ * `CDK_ERROR_OPTIMIZE` is a shortcut which disables backtraces and formatted
+ * messages unless they are set explicitly.
+ */
 #ifdef CDK_ERROR_OPTIMIZE
+#ifndef CDK_ERROR_BTRACE_ENABLE
+#define CDK_ERROR_BTRACE_ENABLE 0
+#endif
+#ifndef CDK_ERROR_FSTR_ENABLE
+#define CDK_ERROR_FSTR_ENABLE 0
+#endif
+#endif
+
+#ifndef CDK_ERROR_BTRACE_ENABLE
+#define CDK_ERROR_BTRACE_ENABLE 1
+#endif
+
+#ifndef CDK_ERROR_FSTR_ENABLE
+#define CDK_ERROR_FSTR_ENABLE 1
+#endif
+
+#if !CDK_ERROR_BTRACE_ENABLE
 #undef CDK_ERROR_BTRACE_MAX
 #define CDK_ERROR_BTRACE_MAX 1
 #endif
 
+/*
+ * Once a backtrace overflows, its first `CDK_ERROR_BTRACE_HEAD` frames keep
+ * the origin and the other slots keep the newest frames. Frames in between are
+ * only counted. `CDK_ERROR_BTRACE_MAX` keeps the origin frames only.
+ */
+#ifndef CDK_ERROR_BTRACE_HEAD
+#define CDK_ERROR_BTRACE_HEAD ((CDK_ERROR_BTRACE_MAX + 1) / 2)
+#endif
+
+#if CDK_ERROR_BTRACE_ENABLE && CDK_ERROR_BTRACE_HEAD > CDK_ERROR_BTRACE_MAX
+#error "CDK_ERROR_BTRACE_HEAD cannot exceed CDK_ERROR_BTRACE_MAX"
+#endif
+
+#define CDK_EFRAME_LINE 1
+#define CDK_EFRAME_FUNC 2
+#define CDK_EFRAME_FULL 3
+
+#ifndef CDK_ERROR_FRAME_INFO
+#define CDK_ERROR_FRAME_INFO CDK_EFRAME_FULL
+#endif
+
+#ifndef CDK_ERROR_SITE_ID_T
+#define CDK_ERROR_SITE_ID_T uint16_t
+#endif
+
+#ifndef CDK_ERROR_HISTORY_MAX
+#define CDK_ERROR_HISTORY_MAX 8
+#endif
+
+#ifndef CDK_ERROR_HISTORY_MSG_MAX
+#define CDK_ERROR_HISTORY_MSG_MAX 64
+#endif
+
+#ifndef CDK_ERROR_CAUSES_MAX
+#define CDK_ERROR_CAUSES_MAX 8
+#endif
+
+#ifndef CDK_ERROR_STACK_MAX
+#define CDK_ERROR_STACK_MAX 4
+#endif
+
+#ifndef CDK_ERROR_DEPTH_ENV
+#define CDK_ERROR_DEPTH_ENV "CDK_ERROR_DEPTH"
+#endif
+
+#ifndef CDK_ERROR_FP_MAX
+#define CDK_ERROR_FP_MAX 16
+#endif
+
+#ifndef CDK_ERROR_FP_CACHE
+#define CDK_ERROR_FP_CACHE 256
+#endif
+
+#ifndef CDK_ERROR_SHADOW_MAX
+#define CDK_ERROR_SHADOW_MAX 64
+#endif
+
+#ifndef CDK_ERROR_FLIGHT_SITES
+#define CDK_ERROR_FLIGHT_SITES 1024
+#endif
+
+/*
+ * `CDK_ERROR_TLS_MODEL` sets the access model of every per-thread variable the
+ * header declares, e.g. "initial-exec" when the header is built into a shared
+ * library, "local-exec" when the variables live in the executable itself.
+ * `CDK_ERROR_TLS_ACCESSOR` reaches the errno slots through a `const` function,
+ * so a function resolves their address once, and implies `CDK_ERROR_TLS_BLOCK`
+ * which keeps both slots in a single per-thread variable.
+ */
+#ifdef CDK_ERROR_TLS_MODEL
+#define CDK_ETLS _Thread_local __attribute__((tls_model(CDK_ERROR_TLS_MODEL)))
+#else
+#define CDK_ETLS _Thread_local
+#endif
+
+#if defined(CDK_ERROR_TLS_ACCESSOR) && !defined(CDK_ERROR_TLS_BLOCK)
+#define CDK_ERROR_TLS_BLOCK
+#endif
+
+/*
+ * With `CDK_ERROR_OUTLINE` error construction and wrapping are emitted once per
+ * translation unit as cold functions, so every site costs only a call and the
+ * error path is moved away from hot code.
+ */
+#ifdef CDK_ERROR_OUTLINE
+#define CDK_ECOLD __attribute__((cold, noinline, unused))
+#else
+#define CDK_ECOLD inline
+#endif
+
 /******************************************************************************
  *                             Data types *
  ******************************************************************************/
@@ -97,11 +222,70 @@
 enum cdk_ErrorType {
   cdk_ErrorType_INT,
   cdk_ErrorType_STR,
-#ifndef CDK_ERROR_OPTIMIZE
+#if CDK_ERROR_FSTR_ENABLE
   cdk_ErrorType_FSTR,
+#ifdef CDK_ERROR_DEFER_FSTR
+  cdk_ErrorType_FSTR_LAZY, // Formatted string not rendered yet
+#endif
 #endif
 };
 
+/**
+ * Error type as stored by binary formats, independent of the build config.
+ */
+enum cdk_EncodedType {
+  cdk_EncodedType_INT,
+  cdk_EncodedType_STR,
+  cdk_EncodedType_FSTR,
+};
+
+/**
+ * Call site descriptor.
+ */
+struct cdk_ESite {
+  const char *file;
+  const char *func;
+  uint32_t line;
+};
+
+/*
+ * With `CDK_ERROR_COLLAPSE` a frame added right after the same frame only bumps
+ * its repeat counter. It takes the padding of full and function frames.
+ */
+#ifdef CDK_ERROR_COLLAPSE
+#define CDK_EFRAME_REPEAT_ uint32_t repeat; // Times added again in a row
+#else
+#define CDK_EFRAME_REPEAT_
+#endif
+
+#ifdef CDK_ERROR_SITE_IDS
+typedef CDK_ERROR_SITE_ID_T cdk_esite_id_t;
+
+/**
+ * Error frame object, index into the site table.
+ */
+struct cdk_EFrame {
+  cdk_esite_id_t site;
+  CDK_EFRAME_REPEAT_
+};
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE
+/**
+ * Error frame object, line only.
+ */
+struct cdk_EFrame {
+  uint32_t line;
+  CDK_EFRAME_REPEAT_
+};
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC
+/**
+ * Error frame object, function and line.
+ */
+struct cdk_EFrame {
+  const char *func;
+  uint32_t line;
+  CDK_EFRAME_REPEAT_
+};
+#else
 /**
  * Error frame object.
  */
@@ -109,7 +293,21 @@ struct cdk_EFrame {
   const char *file;
   const char *func;
   uint32_t line;
+  CDK_EFRAME_REPEAT_
+};
+#endif
+
+#ifdef CDK_ERROR_CAUSES
+struct cdk_Error;
+
+/**
+ * Link to a cause, valid while the error keeps the same ticket.
+ */
+struct cdk_ECauseLink {
+  const struct cdk_Error *ptr;
+  uint32_t ticket;
 };
+#endif
 
 /**
  * Common error object.
@@ -117,11 +315,28 @@ struct cdk_EFrame {
 struct cdk_Error {
   enum cdk_ErrorType type;                         // Error type
   uint16_t code;                                   // Status code
+  bool shared;                                     // Read-only static error
+  bool no_trace;                                   // Wraps add no frames
   const char *msg;                                 // String msg, can be NULL
   struct cdk_EFrame eframes[CDK_ERROR_BTRACE_MAX]; // Backtrace frames
   size_t eframes_len;                              // Backtrace frames length
+  size_t eframes_dropped;                          // Frames lost on overflow
+
+#ifdef CDK_ERROR_SITE_IDS
+  const struct cdk_ESite *esites; // Site table of the object which created it
+#endif
 
-#ifndef CDK_ERROR_OPTIMIZE
+#ifdef CDK_ERROR_CAUSES
+  struct cdk_ECauseLink cause; // Error this one was created from
+  uint32_t ticket;             // Issued once linked as a cause, 0 if never
+#endif
+
+#ifdef CDK_ERROR_FRAME_POINTERS
+  void *eaddrs[CDK_ERROR_FP_MAX]; // Return addresses, innermost first
+  size_t eaddrs_len;              // Return addresses length
+#endif
+
+#if CDK_ERROR_FSTR_ENABLE
   char _msg_buf[CDK_ERROR_FSTR_MAX]; // Internal storage for formatted string
 #endif
 };
@@ -129,205 +344,3778 @@ struct cdk_Error {
 typedef struct cdk_Error *cdk_error_t;
 
 /******************************************************************************
- *                                 Generic API                                *
+ *                                Call sites                                  *
  ******************************************************************************/
-/**
- * Create struct cdk_Error of type cdk_ErrorType_INT.
+#ifdef CDK_ERROR_SITE_IDS
+/*
+ * With `CDK_ERROR_SITE_IDS` every creation and wrap site emits a static
+ * struct cdk_ESite into the `cdk_esites` section. The linker collects them
+ * into one table per executable or shared object, and frames only keep the
+ * table index. Site table can be dumped with `cdk_error_sites_dumps`, or read
+ * from the binary with `tools/export_sites.py`, to decode ids offline.
+ *
+ * Ids of different objects overlap. An error keeps the table of the object
+ * which created it, so it resolves wherever it is dumped, and wraps in other
+ * objects add no frames to it. Traces cover only the creating object.
  */
-static inline cdk_error_t cdk_error_int(struct cdk_Error *err, uint16_t code,
-                                        const char *file, const char *func,
-                                        int line) {
-  *err = (struct cdk_Error){
-      .type = cdk_ErrorType_INT,
-      .code = code,
-      .eframes = {{.file = file, .func = func, .line = line}},
-      .eframes_len = 1,
-  };
+#include <stdlib.h>
 
-  return err;
-};
+extern const struct cdk_ESite __start_cdk_esites[]
+    __attribute__((visibility("hidden")));
+extern const struct cdk_ESite __stop_cdk_esites[]
+    __attribute__((visibility("hidden")));
 
-/**
- * Create struct cdk_Error of type cdk_ErrorType_STR.
- */
-static inline cdk_error_t cdk_error_lstr(struct cdk_Error *err, uint16_t code,
-                                         const char *file, const char *func,
-                                         int line, const char *msg) {
-  *err = (struct cdk_Error){
-      .type = cdk_ErrorType_STR,
-      .code = code,
-      .msg = msg,
-      .eframes = {{.file = file, .func = func, .line = line}},
-      .eframes_len = 1,
-  };
+#define cdk_esite_id()                                                         \
+  ({                                                                           \
+    static const struct cdk_ESite cdk_esite                                    \
+        __attribute__((section("cdk_esites"), used,                            \
+                       aligned(sizeof(void *)))) = {                           \
+            .file = __FILE_NAME__, .func = __func__, .line = __LINE__};        \
+    (cdk_esite_id_t)(&cdk_esite - __start_cdk_esites);                         \
+  })
 
-  return err;
-};
+#define CDK_EFRAME_PARAMS cdk_esite_id_t site
+#define CDK_EFRAME_HERE cdk_esite_id()
+#define CDK_EFRAME_FROM_PARAMS ((struct cdk_EFrame){.site = site})
 
-#ifndef CDK_ERROR_OPTIMIZE
 /**
- * Create struct cdk_Error of type cdk_ErrorType_FSTR.
+ * Resolve frame to its call site in the calling object's table, frames of an
+ * error are resolved with cdk_error_site.
  */
-static inline cdk_error_t cdk_error_fstr(struct cdk_Error *err, uint16_t code,
-                                         const char *file, const char *func,
-                                         int line, const char *fmt, ...) {
-
-  *err = (struct cdk_Error){
-      .type = cdk_ErrorType_FSTR,
-      .code = code,
-      .eframes = {{.file = file, .func = func, .line = line}},
-      .eframes_len = 1,
-  };
-
-  va_list args;
-  va_start(args, fmt);
-  int written_bytes =
-      vsnprintf(err->_msg_buf, sizeof(err->_msg_buf), fmt, args);
-  va_end(args);
-
-  assert(written_bytes >= 0);
+static inline struct cdk_ESite cdk_eframe_site(const struct cdk_EFrame *frame) {
+  return __start_cdk_esites[frame->site];
+}
 
-  err->msg = err->_msg_buf;
+/*
+ * Table size is known only once the object is linked, so whether every id
+ * fits cdk_esite_id_t is checked when the object is loaded.
+ */
+__attribute__((constructor, unused)) static void cdk_esites_check(void) {
+  size_t count = __stop_cdk_esites - __start_cdk_esites;
 
-  return err;
-};
-#endif
+  if (count > 0 && count - 1 > (size_t)(cdk_esite_id_t)-1) {
+    fputs("cdk_error: more call sites than CDK_ERROR_SITE_ID_T can index\n",
+          stderr);
+    abort();
+  }
+}
 
 /**
- * Dump all struct cdk_XError to string.
+ * Dump site table to string, one `id file:func:line` per line.
  */
-static inline int cdk_error_dumps(cdk_error_t err, size_t buf_size, char *buf) {
+static inline int cdk_error_sites_dumps(size_t buf_size, char *buf) {
   size_t offset = 0;
   int written;
 
-  written = snprintf(buf, buf_size,
-                     "====== ERROR DUMP ======\n"
-                     "Error code: %d\n"
-                     "Error desc: %s\n",
-                     err->code, strerror(err->code));
-  if (written < 0 || (size_t)written >= buf_size) {
-    return ENOBUFS;
+  if (buf_size > 0) {
+    buf[0] = 0;
   }
-  offset += written;
 
-  if (err->type > cdk_ErrorType_INT) {
-    written =
-        snprintf(buf + offset, buf_size - offset, "------------------------\n");
-    if (written < 0 || (size_t)written >= buf_size) {
+  for (const struct cdk_ESite *site = __start_cdk_esites;
+       site < __stop_cdk_esites; site++) {
+    written = snprintf(buf + offset, buf_size - offset, "%zu %s:%s:%u\n",
+                       (size_t)(site - __start_cdk_esites), site->file,
+                       site->func, site->line);
+    if (written < 0 || (size_t)written >= buf_size - offset) {
       return ENOBUFS;
     }
     offset += written;
   }
 
-  switch (err->type) {
-  case cdk_ErrorType_STR:
-    written =
-        snprintf(buf + offset, buf_size - offset, " Error msg: %s\n", err->msg);
-    if (written < 0 || (size_t)written >= buf_size - offset) {
-      return ENOBUFS;
-    }
-    offset += written;
-    break;
+  return 0;
+}
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE
+#define CDK_EFRAME_PARAMS int line
+#define CDK_EFRAME_HERE __LINE__
+#define CDK_EFRAME_FROM_PARAMS ((struct cdk_EFrame){.line = line})
 
-#ifndef CDK_ERROR_OPTIMIZE
-  case cdk_ErrorType_FSTR:
-    written = snprintf(buf + offset, buf_size - offset, " Error msg: %.*s\n",
-                       (int)sizeof(err->_msg_buf), err->msg);
-    if (written < 0 || (size_t)written >= buf_size - offset) {
-      return ENOBUFS;
-    }
-    offset += written;
-    break;
-#endif
-  default:;
-  }
+/**
+ * Resolve frame to its call site, parts not recorded read as "?".
+ */
+static inline struct cdk_ESite cdk_eframe_site(const struct cdk_EFrame *frame) {
+  return (struct cdk_ESite){.file = "?", .func = "?", .line = frame->line};
+}
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC
+#define CDK_EFRAME_PARAMS const char *func, int line
+#define CDK_EFRAME_HERE __func__, __LINE__
+#define CDK_EFRAME_FROM_PARAMS ((struct cdk_EFrame){.func = func, .line = line})
 
-  written =
-      snprintf(buf + offset, buf_size - offset, "------------------------\n");
-  if (written < 0 || (size_t)written >= buf_size - offset) {
-    return ENOBUFS;
-  }
-  offset += written;
+/**
+ * Resolve frame to its call site, parts not recorded read as "?".
+ */
+static inline struct cdk_ESite cdk_eframe_site(const struct cdk_EFrame *frame) {
+  return (struct cdk_ESite){
+      .file = "?", .func = frame->func, .line = frame->line};
+}
+#else
+#define CDK_EFRAME_PARAMS const char *file, const char *func, int line
+#define CDK_EFRAME_HERE __FILE_NAME__, __func__, __LINE__
+#define CDK_EFRAME_FROM_PARAMS                                                 \
+  ((struct cdk_EFrame){.file = file, .func = func, .line = line})
 
-  written = snprintf(buf + offset, buf_size - offset, " Backtrace:\n");
-  if (written < 0 || (size_t)written >= buf_size - offset) {
-    return ENOBUFS;
-  }
-  offset += written;
+/**
+ * Resolve frame to its call site.
+ */
+static inline struct cdk_ESite cdk_eframe_site(const struct cdk_EFrame *frame) {
+  return (struct cdk_ESite){
+      .file = frame->file, .func = frame->func, .line = frame->line};
+}
+#endif
 
-  for (int i = 0; i < err->eframes_len; i++) {
-    written = snprintf(buf + offset, buf_size - offset, "   [%02d] %s:%s:%d\n",
-                       i, err->eframes[i].file, err->eframes[i].func,
-                       err->eframes[i].line);
-    if (written < 0 || (size_t)written >= buf_size - offset) {
-      return ENOBUFS;
-    }
-    offset += written;
+/**
+ * Resolve frame of err to its call site.
+ */
+static inline struct cdk_ESite cdk_error_site(const struct cdk_Error *err,
+                                              const struct cdk_EFrame *frame) {
+#ifdef CDK_ERROR_SITE_IDS
+  return err->esites[frame->site];
+#else
+  (void)err;
+  return cdk_eframe_site(frame);
+#endif
+}
+
+/**
+ * Slot holding i-th frame of a backtrace. After an overflow the slots past
+ * CDK_ERROR_BTRACE_HEAD are a ring whose oldest frame is overwritten next.
+ */
+static inline size_t cdk_eframe_slot(size_t eframes_len, size_t dropped,
+                                     size_t i) {
+  if (!dropped || i < CDK_ERROR_BTRACE_HEAD) {
+    return i;
   }
 
-  return 0;
+  return CDK_ERROR_BTRACE_HEAD +
+         (i - CDK_ERROR_BTRACE_HEAD + dropped) %
+             (eframes_len - CDK_ERROR_BTRACE_HEAD);
 }
 
-static inline void cdk_error_add_frame(cdk_error_t err,
-                                       struct cdk_EFrame *frame) {
-  if (err->eframes_len >= CDK_ERROR_BTRACE_MAX) {
-    return;
+/**
+ * Newest frame of err, NULL when it has none or the newest one was dropped past
+ * a full head.
+ */
+static inline struct cdk_EFrame *cdk_error_last_frame(cdk_error_t err) {
+  if (!err->eframes_len ||
+      (err->eframes_dropped && err->eframes_len <= CDK_ERROR_BTRACE_HEAD)) {
+    return NULL;
   }
-  err->eframes[err->eframes_len++] = *frame;
+
+  return &err->eframes[cdk_eframe_slot(err->eframes_len, err->eframes_dropped,
+                                       err->eframes_len - 1)];
 }
 
-#ifndef CDK_ERROR_OPTIMIZE
-#define cdk_error_wrap(err)                                                    \
-  ({                                                                           \
-    cdk_error_add_frame(err, &(struct cdk_EFrame){.file = __FILE_NAME__,       \
-                                                  .func = __func__,            \
-                                                  .line = __LINE__});          \
-    err;                                                                       \
-  })
+#ifdef CDK_ERROR_COLLAPSE
+/**
+ * Whether both frames come from the same call site. Function names are unique
+ * objects, so comparing pointers is enough.
+ */
+static inline bool cdk_eframe_same(const struct cdk_EFrame *a,
+                                   const struct cdk_EFrame *b) {
+#if defined(CDK_ERROR_SITE_IDS)
+  return a->site == b->site;
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE
+  return a->line == b->line;
 #else
-#define cdk_error_wrap(err)
+  return a->func == b->func && a->line == b->line;
+#endif
+}
 #endif
 
-#define cdk_error_return(ret, err)                                             \
-  ({                                                                           \
-    cdk_error_wrap(err);                                                       \
-    ret;                                                                       \
-  })
+/******************************************************************************
+ *                                 Counters                                   *
+ ******************************************************************************/
+#ifdef CDK_ERROR_COUNTERS
+#ifdef __STDC_NO_ATOMICS__
+#error "Atomics extension is required to compile error counters"
+#endif
+#include <stdatomic.h>
 
-#define cdk_errori(err, code)                                                  \
-  cdk_error_int((err), (code), __FILE_NAME__, __func__, __LINE__)
+/*
+ * With `CDK_ERROR_COUNTERS` every creation and `CDK_TRY_CATCH` site owns a
+ * static counter in the `cdk_ecounters` section, bumped with a relaxed atomic
+ * increment. Each counter takes a whole cache line, so hot sites never share
+ * one. Without the macro counting compiles to nothing.
+ */
 
-#define cdk_errors(err, code, msg)                                             \
-  cdk_error_lstr((err), (code), __FILE_NAME__, __func__, __LINE__, (msg))
+/**
+ * Site occurrence counter.
+ */
+struct cdk_ECounter {
+  _Atomic uint64_t count;
+  struct cdk_ESite site;
+} __attribute__((aligned(64)));
 
-#define cdk_errorf(err, code, fmt, ...)                                        \
-  cdk_error_fstr((err), (code), __FILE_NAME__, __func__, __LINE__, (fmt),      \
-                 ##__VA_ARGS__)
+/**
+ * Counter snapshot.
+ */
+struct cdk_ECount {
+  struct cdk_ESite site;
+  uint64_t count;
+};
 
-#define CDK_TRY_CATCH(err, label) if (err){ cdk_error_wrap(err); goto label; }
-#define CDK_TRY(err) CDK_TRY_CATCH(err, error_out)
+extern struct cdk_ECounter __start_cdk_ecounters[]
+    __attribute__((visibility("hidden")));
+extern struct cdk_ECounter __stop_cdk_ecounters[]
+    __attribute__((visibility("hidden")));
 
-/******************************************************************************
- *                                Errno API                                   *
- ******************************************************************************/
-#ifndef CDK_DISABLE_ERRNO_API
-_Thread_local extern cdk_error_t cdk_errno;
-_Thread_local extern struct cdk_Error cdk_hidden_errno;
+#define cdk_ecount()                                                           \
+  ({                                                                           \
+    static struct cdk_ECounter cdk_ecounter                                    \
+        __attribute__((section("cdk_ecounters"), used)) = {                    \
+            .site = {                                                          \
+                .file = __FILE_NAME__, .func = __func__, .line = __LINE__}};   \
+    atomic_fetch_add_explicit(&cdk_ecounter.count, 1, memory_order_relaxed);   \
+  })
+
+/**
+ * Fill top with up to top_len most frequent sites, in descending order.
+ * Sites which never fired are skipped. Return number of filled entries.
+ */
+static inline size_t cdk_error_counters_top(struct cdk_ECount *top,
+                                            size_t top_len) {
+  size_t len = 0;
 
-#define cdk_errnoi(code) cdk_errori(&cdk_hidden_errno, code)
+  if (top_len == 0) {
+    return 0;
+  }
 
-#define cdk_errnos(code, msg) cdk_errors(&cdk_hidden_errno, code, msg)
+  for (struct cdk_ECounter *counter = __start_cdk_ecounters;
+       counter < __stop_cdk_ecounters; counter++) {
+    uint64_t count =
+        atomic_load_explicit(&counter->count, memory_order_relaxed);
+    if (count == 0 || (len == top_len && top[len - 1].count >= count)) {
+      continue;
+    }
 
-#ifndef CDK_ERROR_OPTIMIZE
-#define cdk_errnof(code, fmt, ...)                                             \
-  cdk_errorf(&cdk_hidden_errno, code, fmt, ##__VA_ARGS__)
-#endif
+    size_t i = len < top_len ? len++ : len - 1;
+    for (; i > 0 && top[i - 1].count < count; i--) {
+      top[i] = top[i - 1];
+    }
+    top[i] = (struct cdk_ECount){.site = counter->site, .count = count};
+  }
 
-#define cdk_ewrap() cdk_error_wrap(&cdk_hidden_errno)
+  return len;
+}
 
-#define cdk_ereturn(ret) cdk_error_return((ret), &cdk_hidden_errno)
+/**
+ * Zero all counters.
+ */
+static inline void cdk_error_counters_reset(void) {
+  for (struct cdk_ECounter *counter = __start_cdk_ecounters;
+       counter < __stop_cdk_ecounters; counter++) {
+    atomic_store_explicit(&counter->count, 0, memory_order_relaxed);
+  }
+}
 
-#define cdk_edumps(buf_size, buf)                                              \
-  cdk_error_dumps(&cdk_hidden_errno, buf_size, buf)
+/**
+ * Dump counters snapshot to string.
+ */
+static inline int cdk_error_counters_dumps(const struct cdk_ECount *counts,
+                                           size_t counts_len, size_t buf_size,
+                                           char *buf) {
+  size_t offset = 0;
+  int written;
+
+  written = snprintf(buf, buf_size, "===== ERROR COUNTERS =====\n");
+  if (written < 0 || (size_t)written >= buf_size) {
+    return ENOBUFS;
+  }
+  offset += written;
+
+  for (size_t i = 0; i < counts_len; i++) {
+    written = snprintf(buf + offset, buf_size - offset,
+                       "   [%02zu] %llu %s:%s:%u\n", i,
+                       (unsigned long long)counts[i].count,
+                       counts[i].site.file, counts[i].site.func,
+                       counts[i].site.line);
+    if (written < 0 || (size_t)written >= buf_size - offset) {
+      return ENOBUFS;
+    }
+    offset += written;
+  }
+
+  return 0;
+}
+#else
+#define cdk_ecount() ((void)0)
+#endif
+
+/******************************************************************************
+ *                              Flight recorder                               *
+ ******************************************************************************/
+#ifdef CDK_ERROR_FLIGHT
+#ifdef __STDC_NO_ATOMICS__
+#error "Atomics extension is required to compile flight recorder"
+#endif
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 199309L
+#error "CDK_ERROR_FLIGHT requires _POSIX_C_SOURCE 199309L for clock_gettime"
+#endif
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * With `CDK_ERROR_FLIGHT` every created error is also copied into a ring of
+ * fixed size records living in a shared file mapping. Records reach the page
+ * cache as soon as they are written, so the last errors of all threads
+ * survive a crash or SIGKILL of the process without any flushing.
+ *
+ * File layout, native byte order: struct cdk_EFlightHeader, `records_len`
+ * struct cdk_EFlightRecord, then `sites_len` struct cdk_EFlightSite. Writers
+ * claim a slot with a single atomic fetch-add on `head` and publish the record
+ * by storing its sequence number last, so a record torn by a crash reads back
+ * as empty. A record keeps the origin site, code and time only. Site strings
+ * are copied once per site into the entry its hash selects, records whose
+ * entry was since taken by another site lose file and function. Messages are
+ * not recorded. `tools/read_flight.py` decodes the file.
+ */
+#define CDK_ERROR_FLIGHT_VERSION 2
+#define CDK_EFLIGHT_FILE_MAX 24
+#define CDK_EFLIGHT_FUNC_MAX 28
+#define CDK_EFLIGHT_SITE_EMPTY 0 // Site entry never written
+#define CDK_EFLIGHT_SITE_BUSY 1  // Site entry being written
+
+static_assert((CDK_ERROR_FLIGHT_SITES & (CDK_ERROR_FLIGHT_SITES - 1)) == 0,
+              "CDK_ERROR_FLIGHT_SITES must be a power of two");
+
+#ifdef CLOCK_REALTIME_COARSE
+#define CDK_EFLIGHT_CLOCK CLOCK_REALTIME_COARSE // Tick resolution, no syscall
+#else
+#define CDK_EFLIGHT_CLOCK CLOCK_REALTIME
+#endif
+
+/**
+ * Flight recorder file header.
+ */
+struct cdk_EFlightHeader {
+  char magic[8];         // "cdkeflt", written last on open
+  uint32_t version;      // CDK_ERROR_FLIGHT_VERSION
+  uint32_t record_size;  // sizeof(struct cdk_EFlightRecord)
+  uint64_t records_len;  // Number of records, power of two
+  _Atomic uint64_t head; // Sequence number of the next record
+  uint32_t sites_len;    // Number of site entries, power of two
+  uint32_t site_size;    // sizeof(struct cdk_EFlightSite)
+  uint8_t reserved[24];
+} __attribute__((aligned(64)));
+
+/**
+ * Flight recorder record.
+ */
+struct cdk_EFlightRecord {
+  _Atomic uint64_t seq; // Sequence number + 1, 0 while unset
+  uint64_t time;        // CDK_EFLIGHT_CLOCK time in ns
+  uint64_t thread;      // thrd_current() of the writer
+  uint32_t site;        // Hash of the origin site, 0 if none
+  uint16_t code;        // Status code
+  uint8_t type;         // cdk_EncodedType
+  uint8_t reserved;     // Zero
+} __attribute__((aligned(32)));
+
+/**
+ * Flight recorder site entry, for records whose site hash matches.
+ */
+struct cdk_EFlightSite {
+  _Atomic uint32_t hash;           // Site hash, or CDK_EFLIGHT_SITE_*
+  uint32_t line;                   // Origin line
+  uint8_t file_len;                // Used bytes of file
+  uint8_t func_len;                // Used bytes of func
+  uint8_t reserved[2];             // Zero
+  char file[CDK_EFLIGHT_FILE_MAX]; // Origin file, no terminator
+  char func[CDK_EFLIGHT_FUNC_MAX]; // Origin function, no terminator
+} __attribute__((aligned(64)));
+
+static_assert(sizeof(struct cdk_EFlightHeader) == 64,
+              "flight header layout changed");
+static_assert(sizeof(struct cdk_EFlightRecord) == 32,
+              "flight record layout changed");
+static_assert(sizeof(struct cdk_EFlightSite) == 64,
+              "flight site layout changed");
+
+/**
+ * Process wide flight recorder state.
+ */
+struct cdk_EFlight {
+  struct cdk_EFlightHeader *hdr;     // NULL while closed
+  struct cdk_EFlightRecord *records; // Records following the header
+  struct cdk_EFlightSite *sites;     // Site entries following the records
+  uint64_t mask;                     // records_len - 1
+  size_t size;                       // Mapping size
+};
+
+extern struct cdk_EFlight cdk_hidden_eflight;
+
+/**
+ * Create or truncate the file at path, size it for records_len records and
+ * CDK_ERROR_FLIGHT_SITES sites and map it. records_len has to be a power of
+ * two. Return 0 or errno.
+ */
+static inline int cdk_error_flight_open(const char *path, size_t records_len) {
+  struct cdk_EFlightHeader *hdr;
+  struct cdk_EFlightRecord *records;
+  size_t size;
+  void *map;
+  int fd;
+  int ret;
+
+  if (records_len == 0 || (records_len & (records_len - 1))) {
+    return EINVAL;
+  }
+  if (cdk_hidden_eflight.hdr) {
+    return EBUSY;
+  }
+
+  size = sizeof(struct cdk_EFlightHeader) +
+         records_len * sizeof(struct cdk_EFlightRecord) +
+         CDK_ERROR_FLIGHT_SITES * sizeof(struct cdk_EFlightSite);
+
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return errno;
+  }
+
+  // Grow by writing the last byte, ftruncate is not declared in plain C11.
+  if (lseek(fd, size - 1, SEEK_SET) < 0 || write(fd, "", 1) != 1) {
+    ret = errno;
+    close(fd);
+    return ret;
+  }
+
+  map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ret = errno;
+  close(fd);
+  if (map == MAP_FAILED) {
+    return ret;
+  }
+
+  hdr = map;
+  records = (struct cdk_EFlightRecord *)(hdr + 1);
+  hdr->version = CDK_ERROR_FLIGHT_VERSION;
+  hdr->record_size = sizeof(struct cdk_EFlightRecord);
+  hdr->records_len = records_len;
+  hdr->sites_len = CDK_ERROR_FLIGHT_SITES;
+  hdr->site_size = sizeof(struct cdk_EFlightSite);
+  atomic_store_explicit(&hdr->head, 0, memory_order_relaxed);
+  memcpy(hdr->magic, "cdkeflt", sizeof(hdr->magic));
+
+  cdk_hidden_eflight = (struct cdk_EFlight){
+      .hdr = hdr,
+      .records = records,
+      .sites = (struct cdk_EFlightSite *)(records + records_len),
+      .mask = records_len - 1,
+      .size = size,
+  };
+
+  return 0;
+}
+
+/**
+ * Unmap the flight recorder. No thread may create errors concurrently.
+ */
+static inline void cdk_error_flight_close(void) {
+  if (cdk_hidden_eflight.hdr) {
+    munmap(cdk_hidden_eflight.hdr, cdk_hidden_eflight.size);
+  }
+  cdk_hidden_eflight = (struct cdk_EFlight){0};
+}
+
+static inline uint8_t cdk_eflight_copy(char *dst, size_t dst_size,
+                                       const char *src) {
+  const char *end;
+  size_t len;
+
+  if (!src) {
+    return 0;
+  }
+
+  end = memchr(src, 0, dst_size);
+  len = end ? (size_t)(end - src) : dst_size;
+  memcpy(dst, src, len);
+
+  return len;
+}
+
+/**
+ * Hash of a call site, from the addresses of its strings and its line. Never
+ * one of CDK_EFLIGHT_SITE_*.
+ */
+static inline uint32_t cdk_eflight_hash(const struct cdk_ESite *site) {
+  uint64_t file = (uintptr_t)site->file;
+  uint64_t func = (uintptr_t)site->func;
+  uint64_t key = file ^ (func << 1) ^ site->line;
+  uint32_t hash = (key * 0x9e3779b97f4a7c15ull) >> 32;
+
+  return hash > CDK_EFLIGHT_SITE_BUSY ? hash : hash + 2;
+}
+
+/**
+ * Copy site strings into its entry. An entry being written by another thread
+ * is left alone, records of this site stay without strings until next time.
+ */
+static CDK_ECOLD void cdk_eflight_site_put(struct cdk_EFlightSite *entry,
+                                          uint32_t hash,
+                                          const struct cdk_ESite *site) {
+  uint32_t old = atomic_load_explicit(&entry->hash, memory_order_relaxed);
+
+  if (old == CDK_EFLIGHT_SITE_BUSY ||
+      !atomic_compare_exchange_strong_explicit(
+          &entry->hash, &old, CDK_EFLIGHT_SITE_BUSY, memory_order_acquire,
+          memory_order_relaxed)) {
+    return;
+  }
+
+  entry->line = site->line;
+  entry->file_len = cdk_eflight_copy(entry->file, sizeof(entry->file),
+                                     site->file);
+  entry->func_len = cdk_eflight_copy(entry->func, sizeof(entry->func),
+                                     site->func);
+  atomic_store_explicit(&entry->hash, hash, memory_order_release);
+}
+
+/**
+ * Copy freshly created error into the flight recorder, if open. Besides the
+ * record it only reads the site entry, which is written on a site's first
+ * error.
+ */
+static inline cdk_error_t cdk_error_flight_record(cdk_error_t err) {
+  struct cdk_EFlightRecord *rec;
+  struct cdk_EFlightSite *entry;
+  struct cdk_ESite site;
+  struct timespec now;
+  uint32_t hash = 0;
+  uint64_t seq;
+
+  if (!cdk_hidden_eflight.hdr) {
+    return err;
+  }
+
+  // Static errors start without frames under CDK_ERROR_SITE_IDS.
+  if (err->eframes_len) {
+    site = cdk_error_site(err, &err->eframes[0]);
+    hash = cdk_eflight_hash(&site);
+    entry = &cdk_hidden_eflight.sites[hash & (CDK_ERROR_FLIGHT_SITES - 1)];
+    if (atomic_load_explicit(&entry->hash, memory_order_relaxed) != hash) {
+      cdk_eflight_site_put(entry, hash, &site);
+    }
+  }
+  clock_gettime(CDK_EFLIGHT_CLOCK, &now);
+
+  seq = atomic_fetch_add_explicit(&cdk_hidden_eflight.hdr->head, 1,
+                                  memory_order_relaxed);
+  rec = &cdk_hidden_eflight.records[seq & cdk_hidden_eflight.mask];
+
+  atomic_store_explicit(&rec->seq, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  rec->time = now.tv_sec * 1000000000ull + now.tv_nsec;
+  rec->thread = (uintptr_t)thrd_current();
+  rec->site = hash;
+  rec->code = err->code;
+  rec->type = err->type == cdk_ErrorType_INT   ? cdk_EncodedType_INT
+              : err->type == cdk_ErrorType_STR ? cdk_EncodedType_STR
+                                               : cdk_EncodedType_FSTR;
+
+  atomic_store_explicit(&rec->seq, seq + 1, memory_order_release);
+
+  return err;
+}
+#else
+#define cdk_error_flight_record(err) (err)
+#endif
+
+/******************************************************************************
+ *                              Runtime depth                                 *
+ ******************************************************************************/
+#ifdef CDK_ERROR_DEPTH
+#include <stdlib.h>
+/*
+ * With `CDK_ERROR_DEPTH` every thread has its own backtrace depth limit, from 1
+ * to CDK_ERROR_BTRACE_MAX, checked by cdk_error_add_frame instead of the
+ * compile-time maximum. The limit is read from the `CDK_ERROR_DEPTH_ENV`
+ * environment variable on the thread's first wrap and can be changed at any
+ * time with cdk_error_depth_set. Errors still reserve CDK_ERROR_BTRACE_MAX
+ * frames.
+ */
+CDK_ETLS extern size_t cdk_hidden_edepth; // 0 until initialized
+
+/**
+ * Initialize calling thread's depth limit from the environment. Missing, zero,
+ * invalid and too large values select CDK_ERROR_BTRACE_MAX.
+ */
+static inline size_t cdk_error_depth_init(void) {
+  const char *env = getenv(CDK_ERROR_DEPTH_ENV);
+  unsigned long depth = CDK_ERROR_BTRACE_MAX;
+  char *end;
+
+  if (env && *env) {
+    depth = strtoul(env, &end, 10);
+    if (*end || depth == 0 || depth > CDK_ERROR_BTRACE_MAX) {
+      depth = CDK_ERROR_BTRACE_MAX;
+    }
+  }
+  cdk_hidden_edepth = depth;
+
+  return depth;
+}
+
+/**
+ * Get calling thread's depth limit.
+ */
+static inline size_t cdk_error_depth_get(void) {
+  return cdk_hidden_edepth ? cdk_hidden_edepth : cdk_error_depth_init();
+}
+
+/**
+ * Set calling thread's depth limit. Errors which are already deeper keep
+ * their frames. EINVAL if depth is 0 or above CDK_ERROR_BTRACE_MAX.
+ */
+static inline int cdk_error_depth_set(size_t depth) {
+  if (depth == 0 || depth > CDK_ERROR_BTRACE_MAX) {
+    return EINVAL;
+  }
+  cdk_hidden_edepth = depth;
+
+  return 0;
+}
+#endif
+
+/******************************************************************************
+ *                                 Sampling                                   *
+ ******************************************************************************/
+#ifdef CDK_ERROR_SAMPLE
+#include <time.h>
+/*
+ * With `CDK_ERROR_SAMPLE` only some errors collect a backtrace. The decision is
+ * made once on creation from the thread's sampler, errors which are not
+ * sampled keep code, message and origin frame and every wrap skips them after
+ * one flag test. A zeroed sampler traces every error.
+ */
+
+/**
+ * Per-thread sampling state.
+ */
+struct cdk_ESampler {
+  uint32_t every;     // Trace one error in every, 0 and 1 trace all
+  uint32_t countdown; // Errors to skip before the next traced one
+  uint32_t rate;      // Traced errors per second, 0 disables the bucket
+  uint32_t burst;     // Bucket capacity
+  uint64_t tokens;    // Tokens left, scaled by 1e9
+  uint64_t last_ns;   // Time of the last refill
+};
+
+CDK_ETLS extern struct cdk_ESampler cdk_hidden_esampler;
+
+static inline uint64_t cdk_esample_now(void) {
+  struct timespec ts;
+
+  timespec_get(&ts, TIME_UTC);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Decide whether next error is traced.
+ */
+static inline bool cdk_error_sample(struct cdk_ESampler *sampler) {
+  if (sampler->every > 1) {
+    if (sampler->countdown > 0) {
+      sampler->countdown--;
+      return false;
+    }
+    sampler->countdown = sampler->every - 1;
+  }
+
+  if (sampler->rate) {
+    // Clock is read only once the bucket runs dry.
+    if (sampler->tokens < 1000000000u) {
+      uint64_t now = cdk_esample_now();
+      uint64_t max = (uint64_t)sampler->burst * 1000000000u;
+
+      // Wall clock may step back, such interval refills nothing. Longer idle
+      // than a full refill is clamped so the product cannot wrap.
+      if (now > sampler->last_ns) {
+        uint64_t elapsed = now - sampler->last_ns;
+        uint64_t fill = (max + sampler->rate - 1) / sampler->rate;
+
+        elapsed = elapsed < fill ? elapsed : fill;
+        sampler->tokens += elapsed * sampler->rate;
+      }
+      sampler->tokens = sampler->tokens < max ? sampler->tokens : max;
+      sampler->last_ns = now;
+      if (sampler->tokens < 1000000000u) {
+        return false;
+      }
+    }
+    sampler->tokens -= 1000000000u;
+  }
+
+  return true;
+}
+
+/**
+ * Trace one error in every `every` on calling thread, 0 and 1 trace all.
+ */
+static inline void cdk_error_sample_every(uint32_t every) {
+  cdk_hidden_esampler.every = every;
+  cdk_hidden_esampler.countdown = 0;
+}
+
+/**
+ * Trace at most `rate` errors per second on calling thread, after a burst of
+ * `burst`. Rate 0 disables the limit.
+ */
+static inline void cdk_error_sample_rate(uint32_t rate, uint32_t burst) {
+  struct cdk_ESampler *sampler = &cdk_hidden_esampler;
+
+  sampler->rate = rate;
+  sampler->burst = burst ? burst : 1;
+  sampler->tokens = (uint64_t)sampler->burst * 1000000000u;
+  sampler->last_ns = cdk_esample_now();
+}
+#endif
+
+/******************************************************************************
+ *                              Frame pointers                                *
+ ******************************************************************************/
+#ifdef CDK_ERROR_FRAME_POINTERS
+#include <dlfcn.h>
+#include <stdatomic.h>
+/*
+ * With `CDK_ERROR_FRAME_POINTERS` every created error also records up to
+ * CDK_ERROR_FP_MAX raw return addresses by walking the frame pointer chain, so
+ * callers which never wrap show up too. Nothing is resolved on creation, dumps
+ * to string resolve addresses with dladdr(3) through a per-process cache.
+ * Requires `_GNU_SOURCE` for dladdr, code built with `-fno-omit-frame-pointer`
+ * and, for names of functions in the executable, linking with `-rdynamic`.
+ */
+#if !defined(_GNU_SOURCE)
+#error "CDK_ERROR_FRAME_POINTERS requires _GNU_SOURCE for dladdr"
+#endif
+
+static_assert((CDK_ERROR_FP_CACHE & (CDK_ERROR_FP_CACHE - 1)) == 0,
+              "CDK_ERROR_FP_CACHE must be a power of two");
+
+/**
+ * Resolved return address.
+ */
+struct cdk_ESymbol {
+  const void *addr;   // Return address, NULL if entry is unused
+  const char *name;   // Symbol name, NULL if unknown
+  const char *module; // Object file name, NULL if unknown
+  uintptr_t offset;   // From symbol, or from module base if name is NULL
+};
+
+/**
+ * Per-process cache of resolved addresses, direct mapped.
+ */
+struct cdk_ESymCache {
+  struct cdk_ESymbol symbols[CDK_ERROR_FP_CACHE];
+  atomic_flag lock;
+};
+
+extern struct cdk_ESymCache cdk_hidden_esymcache;
+
+/**
+ * Store at most max return addresses, innermost first. First one points into
+ * the function which called the walk. Stops at the first link which does not
+ * look like a caller's frame: not above the current one, misaligned or more
+ * than 1 MiB away.
+ */
+static __attribute__((noinline, unused)) size_t
+cdk_error_fp_walk(void **addrs, size_t max) {
+  void **fp = __builtin_frame_address(0);
+  size_t len = 0;
+
+  while (len < max && fp[1]) {
+    void **next = fp[0];
+
+    addrs[len++] = fp[1];
+    if (next <= fp || (uintptr_t)next - (uintptr_t)fp > (1u << 20) ||
+        (uintptr_t)next % sizeof(void *)) {
+      break;
+    }
+    fp = next;
+  }
+
+  return len;
+}
+
+/**
+ * Resolve return address, through the cache. Not async-signal-safe.
+ */
+static inline struct cdk_ESymbol cdk_error_fp_resolve(const void *addr) {
+  struct cdk_ESymCache *cache = &cdk_hidden_esymcache;
+  struct cdk_ESymbol *entry =
+      &cache->symbols[((uintptr_t)addr >> 2) & (CDK_ERROR_FP_CACHE - 1)];
+  struct cdk_ESymbol symbol = {.addr = addr};
+  bool hit;
+  Dl_info info;
+
+  while (atomic_flag_test_and_set_explicit(&cache->lock,
+                                           memory_order_acquire)) {
+  }
+  hit = entry->addr == addr;
+  if (hit) {
+    symbol = *entry;
+  }
+  atomic_flag_clear_explicit(&cache->lock, memory_order_release);
+  if (hit) {
+    return symbol;
+  }
+
+  // Return address may be past the end of a noreturn call's function.
+  if (dladdr((const char *)addr - 1, &info)) {
+    const char *slash = info.dli_fname ? strrchr(info.dli_fname, '/') : NULL;
+
+    symbol.module = slash ? slash + 1 : info.dli_fname;
+    symbol.name = info.dli_sname;
+    symbol.offset = (uintptr_t)addr - (uintptr_t)(info.dli_sname
+                                                      ? info.dli_saddr
+                                                      : info.dli_fbase);
+  }
+
+  while (atomic_flag_test_and_set_explicit(&cache->lock,
+                                           memory_order_acquire)) {
+  }
+  *entry = symbol;
+  atomic_flag_clear_explicit(&cache->lock, memory_order_release);
+
+  return symbol;
+}
+#endif
+
+/******************************************************************************
+ *                               Shadow stack                                 *
+ ******************************************************************************/
+#ifdef CDK_ERROR_SHADOW
+/*
+ * With `CDK_ERROR_SHADOW` functions starting with CDK_FUNC_ENTER push their
+ * entry frame to a per-thread shadow stack and pop it when they return. Every
+ * created error appends the frames of its callers after its origin frame, as
+ * if each of them wrapped it, so the trace is complete without a wrap on every
+ * return and obeys the same depth limit and overflow rules. The entry frame of
+ * the function which creates the error is left out, its origin frame already
+ * points into it. Frames of calls deeper than CDK_ERROR_SHADOW_MAX are not
+ * recorded.
+ */
+
+/**
+ * Per-thread shadow stack.
+ */
+struct cdk_EShadow {
+  struct cdk_EFrame frames[CDK_ERROR_SHADOW_MAX]; // Innermost at the lowest
+  size_t len;                                     // Depth, can exceed the max
+};
+
+CDK_ETLS extern struct cdk_EShadow cdk_hidden_eshadow;
+
+/**
+ * Push frame, return depth to restore on exit.
+ */
+static inline size_t cdk_eshadow_push(struct cdk_EFrame frame) {
+  struct cdk_EShadow *shadow = &cdk_hidden_eshadow;
+  size_t depth = shadow->len++;
+
+  if (depth < CDK_ERROR_SHADOW_MAX) {
+    shadow->frames[CDK_ERROR_SHADOW_MAX - 1 - depth] = frame;
+  }
+
+  return depth;
+}
+
+/**
+ * Cleanup of CDK_FUNC_ENTER. Restoring the depth instead of decrementing it
+ * also drops frames of callees which left through longjmp.
+ */
+static inline void cdk_eshadow_pop(size_t *depth) {
+  cdk_hidden_eshadow.len = *depth;
+}
+
+/*
+ * Depth of the enclosing CDK_FUNC_ENTER frame, shadowed by the one it declares.
+ * Errors created outside of such function take every frame.
+ */
+static const size_t cdk_eshadow_depth __attribute__((unused)) = SIZE_MAX;
+
+/**
+ * Push function's entry frame for the rest of the enclosing scope, put it first
+ * in a function body.
+ */
+#define CDK_FUNC_ENTER()                                                       \
+  _Pragma("GCC diagnostic push")                                               \
+  _Pragma("GCC diagnostic ignored \"-Wshadow\"")                               \
+  __attribute__((cleanup(cdk_eshadow_pop), unused)) size_t cdk_eshadow_depth = \
+      cdk_eshadow_push((struct cdk_EFrame){CDK_EFRAME_HERE});                   \
+  _Pragma("GCC diagnostic pop")
+#else
+#define CDK_FUNC_ENTER()
+#endif
+
+/******************************************************************************
+ *                                 Generic API                                *
+ ******************************************************************************/
+/**
+ * Initialize struct cdk_Error header, message and origin frame, nothing past it
+ * is collected.
+ *
+ * Only fields which are read back are written, frames past `eframes_len` and
+ * `_msg_buf` keep whatever they held before. Define `CDK_ERROR_ZERO_INIT` to
+ * zero the whole object on every creation instead.
+ */
+static inline cdk_error_t cdk_error_init_origin(struct cdk_Error *err,
+                                                enum cdk_ErrorType type,
+                                                uint16_t code, const char *msg,
+                                                struct cdk_EFrame frame,
+                                                bool no_trace) {
+#ifdef CDK_ERROR_ZERO_INIT
+  *err = (struct cdk_Error){
+      .type = type,
+      .code = code,
+      .no_trace = no_trace,
+      .msg = msg,
+      .eframes = {frame},
+      .eframes_len = 1,
+#ifdef CDK_ERROR_SITE_IDS
+      .esites = __start_cdk_esites,
+#endif
+  };
+#else
+  err->type = type;
+  err->code = code;
+  err->shared = false;
+  err->no_trace = no_trace;
+  err->msg = msg;
+  err->eframes[0] = frame;
+  err->eframes_len = 1;
+  err->eframes_dropped = 0;
+#ifdef CDK_ERROR_SITE_IDS
+  err->esites = __start_cdk_esites;
+#endif
+#ifdef CDK_ERROR_CAUSES
+  err->cause = (struct cdk_ECauseLink){0};
+  err->ticket = 0;
+#endif
+#ifdef CDK_ERROR_FRAME_POINTERS
+  err->eaddrs_len = 0;
+#endif
+#endif
+
+  return err;
+}
+
+/**
+ * Initialize new struct cdk_Error created at frame. Unless the sampler skips
+ * it, the caller's return addresses are collected too.
+ */
+static inline cdk_error_t cdk_error_init(struct cdk_Error *err,
+                                         enum cdk_ErrorType type,
+                                         uint16_t code, const char *msg,
+                                         struct cdk_EFrame frame) {
+#ifdef CDK_ERROR_SAMPLE
+  bool no_trace = !cdk_error_sample(&cdk_hidden_esampler);
+#else
+  bool no_trace = false;
+#endif
+
+  cdk_error_init_origin(err, type, code, msg, frame, no_trace);
+
+#ifdef CDK_ERROR_FRAME_POINTERS
+  if (!no_trace) {
+    err->eaddrs_len = cdk_error_fp_walk(err->eaddrs, CDK_ERROR_FP_MAX);
+  }
+#endif
+
+  return err;
+}
+
+/**
+ * Create struct cdk_Error of type cdk_ErrorType_INT.
+ */
+static CDK_ECOLD cdk_error_t cdk_error_int(struct cdk_Error *err, uint16_t code,
+                                           CDK_EFRAME_PARAMS) {
+  return cdk_error_flight_record(cdk_error_init(
+      err, cdk_ErrorType_INT, code, NULL, CDK_EFRAME_FROM_PARAMS));
+};
+
+/**
+ * Create struct cdk_Error of type cdk_ErrorType_STR.
+ */
+static CDK_ECOLD cdk_error_t cdk_error_lstr(struct cdk_Error *err,
+                                            uint16_t code, CDK_EFRAME_PARAMS,
+                                            const char *msg) {
+  return cdk_error_flight_record(cdk_error_init(
+      err, cdk_ErrorType_STR, code, msg, CDK_EFRAME_FROM_PARAMS));
+};
+
+#if CDK_ERROR_FSTR_ENABLE && defined(CDK_ERROR_DEFER_FSTR)
+/******************************************************************************
+ *                            Deferred formatting                             *
+ ******************************************************************************/
+/*
+ * With `CDK_ERROR_DEFER_FSTR` formatted errors are not formatted on creation.
+ * `cdk_error_fstr` walks the format once and copies every argument in its
+ * binary form into `_msg_buf` (strings by content), while `msg` keeps the
+ * format. The message is rendered on first read, by `cdk_error_msg` or
+ * `cdk_error_dumps`. Formats which cannot be captured (`%n`, wide strings,
+ * arguments not fitting into `_msg_buf`) are formatted on creation.
+ */
+
+#define CDK_EFMT_SPEC_MAX 32
+
+/**
+ * Binary form of printf argument.
+ */
+enum cdk_EArg {
+  cdk_EArg_NONE,
+  cdk_EArg_INT,
+  cdk_EArg_LONG,
+  cdk_EArg_LLONG,
+  cdk_EArg_INTMAX,
+  cdk_EArg_SIZE,
+  cdk_EArg_PTRDIFF,
+  cdk_EArg_DOUBLE,
+  cdk_EArg_LDOUBLE,
+  cdk_EArg_PTR,
+  cdk_EArg_STR,
+  cdk_EArg_INVALID,
+};
+
+/**
+ * Conversion specification, from `%` up to the conversion character.
+ */
+struct cdk_EFmtSpec {
+  const char *start;
+  size_t len;
+  int stars;      // Number of `*` arguments preceding the value
+  int precision;  // Precision from format, -1 if not given
+  bool prec_star; // Precision is the last `*` argument
+  enum cdk_EArg arg;
+};
+
+/**
+ * Find and parse next conversion specification, NULL if there is none.
+ */
+static inline const char *cdk_efmt_next(const char *fmt,
+                                        struct cdk_EFmtSpec *spec) {
+  const char *p = strchr(fmt, '%');
+  if (!p) {
+    return NULL;
+  }
+
+  const char *q = p + 1;
+  char mod = 0;
+
+  spec->start = p;
+  spec->stars = 0;
+  spec->precision = -1;
+  spec->prec_star = false;
+
+  while (*q == '-' || *q == '+' || *q == ' ' || *q == '#' || *q == '0' ||
+         *q == '\'') {
+    q++;
+  }
+
+  if (*q == '*') {
+    spec->stars++;
+    q++;
+  } else {
+    while (*q >= '0' && *q <= '9') {
+      q++;
+    }
+  }
+
+  if (*q == '.') {
+    q++;
+    spec->precision = 0;
+    if (*q == '*') {
+      spec->stars++;
+      spec->prec_star = true;
+      q++;
+    } else {
+      while (*q >= '0' && *q <= '9') {
+        spec->precision = spec->precision * 10 + (*q++ - '0');
+      }
+    }
+  }
+
+  switch (*q) {
+  case 'h':
+  case 'j':
+  case 'z':
+  case 't':
+  case 'L':
+    mod = *q++;
+    if (mod == 'h' && *q == 'h') {
+      q++;
+    }
+    break;
+  case 'l':
+    mod = *q++;
+    if (*q == 'l') {
+      mod = 'q';
+      q++;
+    }
+    break;
+  default:;
+  }
+
+  switch (*q) {
+  case 'd':
+  case 'i':
+  case 'u':
+  case 'o':
+  case 'x':
+  case 'X':
+    spec->arg = mod == 'l'   ? cdk_EArg_LONG
+                : mod == 'q' ? cdk_EArg_LLONG
+                : mod == 'j' ? cdk_EArg_INTMAX
+                : mod == 'z' ? cdk_EArg_SIZE
+                : mod == 't' ? cdk_EArg_PTRDIFF
+                : mod == 'L' ? cdk_EArg_INVALID
+                             : cdk_EArg_INT;
+    break;
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  case 'a':
+  case 'A':
+    spec->arg = mod == 'L'                 ? cdk_EArg_LDOUBLE
+                : (mod == 0 || mod == 'l') ? cdk_EArg_DOUBLE
+                                           : cdk_EArg_INVALID;
+    break;
+  case 'c':
+    spec->arg = mod == 0 ? cdk_EArg_INT : cdk_EArg_INVALID;
+    break;
+  case 's':
+    spec->arg = mod == 0 ? cdk_EArg_STR : cdk_EArg_INVALID;
+    break;
+  case 'p':
+    spec->arg = mod == 0 ? cdk_EArg_PTR : cdk_EArg_INVALID;
+    break;
+  case '%':
+    spec->arg = q == p + 1 ? cdk_EArg_NONE : cdk_EArg_INVALID;
+    break;
+  default:
+    spec->arg = cdk_EArg_INVALID;
+    spec->len = q - p;
+    return q;
+  }
+
+  spec->len = q - p + 1;
+  if (spec->len >= CDK_EFMT_SPEC_MAX) {
+    spec->arg = cdk_EArg_INVALID;
+  }
+
+  return q + 1;
+}
+
+static inline bool cdk_efmt_push(char *buf, size_t buf_size, size_t *offset,
+                                 const void *data, size_t size) {
+  if (size > buf_size - *offset) {
+    return false;
+  }
+
+  memcpy(buf + *offset, data, size);
+  *offset += size;
+
+  return true;
+}
+
+#define cdk_efmt_push_arg_(type)                                               \
+  ({                                                                           \
+    type cdk_earg_ = va_arg(args, type);                                       \
+    cdk_efmt_push(buf, buf_size, &offset, &cdk_earg_, sizeof(cdk_earg_));      \
+  })
+
+/**
+ * Copy arguments described by fmt into buf. Return false if fmt cannot be
+ * deferred or arguments do not fit.
+ */
+static inline bool cdk_efmt_capture(char *buf, size_t buf_size,
+                                    const char *fmt, va_list args) {
+  struct cdk_EFmtSpec spec;
+  size_t offset = 0;
+  int star = 0;
+  bool ok = true;
+
+  while (ok && (fmt = cdk_efmt_next(fmt, &spec))) {
+    for (int i = 0; ok && i < spec.stars; i++) {
+      star = va_arg(args, int);
+      ok = cdk_efmt_push(buf, buf_size, &offset, &star, sizeof(star));
+    }
+
+    switch (spec.arg) {
+    case cdk_EArg_NONE:
+      break;
+    case cdk_EArg_INT:
+      ok = ok && cdk_efmt_push_arg_(int);
+      break;
+    case cdk_EArg_LONG:
+      ok = ok && cdk_efmt_push_arg_(long);
+      break;
+    case cdk_EArg_LLONG:
+      ok = ok && cdk_efmt_push_arg_(long long);
+      break;
+    case cdk_EArg_INTMAX:
+      ok = ok && cdk_efmt_push_arg_(intmax_t);
+      break;
+    case cdk_EArg_SIZE:
+      ok = ok && cdk_efmt_push_arg_(size_t);
+      break;
+    case cdk_EArg_PTRDIFF:
+      ok = ok && cdk_efmt_push_arg_(ptrdiff_t);
+      break;
+    case cdk_EArg_DOUBLE:
+      ok = ok && cdk_efmt_push_arg_(double);
+      break;
+    case cdk_EArg_LDOUBLE:
+      ok = ok && cdk_efmt_push_arg_(long double);
+      break;
+    case cdk_EArg_PTR:
+      ok = ok && cdk_efmt_push_arg_(void *);
+      break;
+    case cdk_EArg_STR: {
+      const char *str = va_arg(args, const char *);
+      int precision = spec.prec_star ? star : spec.precision;
+      size_t len;
+
+      if (!str) {
+        str = "(null)";
+      }
+      if (precision >= 0) {
+        const char *end = memchr(str, 0, precision);
+        len = end ? (size_t)(end - str) : (size_t)precision;
+      } else {
+        len = strlen(str);
+      }
+
+      ok = ok && cdk_efmt_push(buf, buf_size, &offset, str, len) &&
+           cdk_efmt_push(buf, buf_size, &offset, "", 1);
+      break;
+    }
+    default:
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+#undef cdk_efmt_push_arg_
+
+static inline void cdk_efmt_put(char *buf, size_t buf_size, size_t *offset,
+                                const char *data, size_t size) {
+  if (size > buf_size - 1 - *offset) {
+    size = buf_size - 1 - *offset;
+  }
+
+  memcpy(buf + *offset, data, size);
+  *offset += size;
+}
+
+#define cdk_efmt_print_arg_(type)                                              \
+  ({                                                                           \
+    type cdk_earg_;                                                            \
+    memcpy(&cdk_earg_, args, sizeof(cdk_earg_));                               \
+    args += sizeof(cdk_earg_);                                                 \
+    spec.stars == 0   ? snprintf(out, out_size, spec_buf, cdk_earg_)           \
+    : spec.stars == 1 ? snprintf(out, out_size, spec_buf, stars[0], cdk_earg_) \
+                      : snprintf(out, out_size, spec_buf, stars[0], stars[1],  \
+                                 cdk_earg_);                                   \
+  })
+
+/**
+ * Render deferred message into `_msg_buf`. No-op for other error types.
+ */
+static inline void cdk_error_render(cdk_error_t err) {
+  if (err->type != cdk_ErrorType_FSTR_LAZY) {
+    return;
+  }
+
+  char msg[sizeof(err->_msg_buf)];
+  char spec_buf[CDK_EFMT_SPEC_MAX];
+  const char *args = err->_msg_buf;
+  const char *fmt = err->msg;
+  const char *next;
+  struct cdk_EFmtSpec spec;
+  size_t offset = 0;
+  int stars[2];
+  int written;
+
+  while ((next = cdk_efmt_next(fmt, &spec))) {
+    cdk_efmt_put(msg, sizeof(msg), &offset, fmt, spec.start - fmt);
+    fmt = next;
+
+    for (int i = 0; i < spec.stars; i++) {
+      memcpy(&stars[i], args, sizeof(stars[i]));
+      args += sizeof(stars[i]);
+    }
+
+    memcpy(spec_buf, spec.start, spec.len);
+    spec_buf[spec.len] = 0;
+
+    char *out = msg + offset;
+    size_t out_size = sizeof(msg) - offset;
+
+    switch (spec.arg) {
+    case cdk_EArg_INT:
+      written = cdk_efmt_print_arg_(int);
+      break;
+    case cdk_EArg_LONG:
+      written = cdk_efmt_print_arg_(long);
+      break;
+    case cdk_EArg_LLONG:
+      written = cdk_efmt_print_arg_(long long);
+      break;
+    case cdk_EArg_INTMAX:
+      written = cdk_efmt_print_arg_(intmax_t);
+      break;
+    case cdk_EArg_SIZE:
+      written = cdk_efmt_print_arg_(size_t);
+      break;
+    case cdk_EArg_PTRDIFF:
+      written = cdk_efmt_print_arg_(ptrdiff_t);
+      break;
+    case cdk_EArg_DOUBLE:
+      written = cdk_efmt_print_arg_(double);
+      break;
+    case cdk_EArg_LDOUBLE:
+      written = cdk_efmt_print_arg_(long double);
+      break;
+    case cdk_EArg_PTR:
+      written = cdk_efmt_print_arg_(void *);
+      break;
+    case cdk_EArg_STR: {
+      const char *str = args;
+      args += strlen(str) + 1;
+      written = spec.stars == 0 ? snprintf(out, out_size, spec_buf, str)
+                : spec.stars == 1
+                    ? snprintf(out, out_size, spec_buf, stars[0], str)
+                    : snprintf(out, out_size, spec_buf, stars[0], stars[1], str);
+      break;
+    }
+    default:
+      written = 0;
+      cdk_efmt_put(msg, sizeof(msg), &offset, "%", 1);
+    }
+
+    if (written > 0) {
+      offset += (size_t)written < out_size ? (size_t)written : out_size - 1;
+    }
+  }
+
+  cdk_efmt_put(msg, sizeof(msg), &offset, fmt, strlen(fmt));
+  msg[offset] = 0;
+
+  memcpy(err->_msg_buf, msg, offset + 1);
+  err->msg = err->_msg_buf;
+  err->type = cdk_ErrorType_FSTR;
+}
+
+#undef cdk_efmt_print_arg_
+
+/**
+ * Bytes of arguments captured by cdk_efmt_capture for fmt.
+ */
+static inline size_t cdk_efmt_args_size(const char *fmt, const char *args) {
+  struct cdk_EFmtSpec spec;
+  size_t size = 0;
+
+  while ((fmt = cdk_efmt_next(fmt, &spec))) {
+    size += spec.stars * sizeof(int);
+
+    switch (spec.arg) {
+    case cdk_EArg_INT:
+      size += sizeof(int);
+      break;
+    case cdk_EArg_LONG:
+      size += sizeof(long);
+      break;
+    case cdk_EArg_LLONG:
+      size += sizeof(long long);
+      break;
+    case cdk_EArg_INTMAX:
+      size += sizeof(intmax_t);
+      break;
+    case cdk_EArg_SIZE:
+      size += sizeof(size_t);
+      break;
+    case cdk_EArg_PTRDIFF:
+      size += sizeof(ptrdiff_t);
+      break;
+    case cdk_EArg_DOUBLE:
+      size += sizeof(double);
+      break;
+    case cdk_EArg_LDOUBLE:
+      size += sizeof(long double);
+      break;
+    case cdk_EArg_PTR:
+      size += sizeof(void *);
+      break;
+    case cdk_EArg_STR:
+      size += strlen(args + size) + 1;
+      break;
+    default:;
+    }
+  }
+
+  return size;
+}
+#endif
+
+#if CDK_ERROR_FSTR_ENABLE
+/**
+ * Create struct cdk_Error of type cdk_ErrorType_FSTR.
+ */
+static CDK_ECOLD cdk_error_t cdk_error_fstr(struct cdk_Error *err,
+                                            uint16_t code, CDK_EFRAME_PARAMS,
+                                            const char *fmt, ...) {
+  cdk_error_init(err, cdk_ErrorType_FSTR, code, err->_msg_buf,
+                 CDK_EFRAME_FROM_PARAMS);
+
+  va_list args;
+  va_start(args, fmt);
+#ifdef CDK_ERROR_DEFER_FSTR
+  va_list eager_args;
+  va_copy(eager_args, args);
+
+  if (cdk_efmt_capture(err->_msg_buf, sizeof(err->_msg_buf), fmt, args)) {
+    err->type = cdk_ErrorType_FSTR_LAZY;
+    err->msg = fmt;
+  } else {
+    vsnprintf(err->_msg_buf, sizeof(err->_msg_buf), fmt, eager_args);
+  }
+
+  va_end(eager_args);
+#else
+  int written_bytes =
+      vsnprintf(err->_msg_buf, sizeof(err->_msg_buf), fmt, args);
+
+  assert(written_bytes >= 0);
+  (void)written_bytes;
+#endif
+  va_end(args);
+
+  return cdk_error_flight_record(err);
+};
+#endif
+
+/**
+ * Get error message, NULL for integer errors.
+ */
+static inline const char *cdk_error_msg(cdk_error_t err) {
+#if CDK_ERROR_FSTR_ENABLE && defined(CDK_ERROR_DEFER_FSTR)
+  cdk_error_render(err);
+#endif
+  return err->msg;
+}
+
+#ifdef CDK_ERROR_CAUSES
+/******************************************************************************
+ *                                  Causes                                    *
+ ******************************************************************************/
+/*
+ * Chained constructors build the new error in the next entry of a per-thread
+ * slab and link it to the error it replaces. Errors in the slab are linked in
+ * place, the root of a chain lives elsewhere and would be overwritten by the
+ * next plain error, so it is copied into the slab once on its first link. The
+ * slab is a ring of CDK_ERROR_CAUSES_MAX errors; an error gets a ticket when
+ * it is linked and loses it when its storage is reused, so links are followed
+ * only while the ticket matches and long chains lose their oldest causes
+ * instead of allocating.
+ */
+_Static_assert((CDK_ERROR_CAUSES_MAX & (CDK_ERROR_CAUSES_MAX - 1)) == 0 &&
+                   CDK_ERROR_CAUSES_MAX >= 2,
+               "CDK_ERROR_CAUSES_MAX must be a power of two, at least 2");
+
+/**
+ * Cause slab.
+ */
+struct cdk_ECauses {
+  struct cdk_Error errors[CDK_ERROR_CAUSES_MAX];
+  uint32_t next;    // Entries handed out
+  uint32_t tickets; // Last issued ticket
+};
+
+/**
+ * Follow link, NULL if there is no cause or its storage was reused.
+ */
+static inline const struct cdk_Error *
+cdk_ecause_get(const struct cdk_ECauseLink *link) {
+  if (!link->ptr || link->ptr->ticket != link->ticket) {
+    return NULL;
+  }
+
+  return link->ptr;
+}
+
+/**
+ * Direct cause of err, NULL if none.
+ */
+static inline const struct cdk_Error *cdk_error_cause(cdk_error_t err) {
+  return cdk_ecause_get(&err->cause);
+}
+
+/**
+ * Next slab entry, the storage of a chained error.
+ */
+static inline struct cdk_Error *
+cdk_error_cause_slot(struct cdk_ECauses *causes) {
+  return &causes->errors[causes->next++ & (CDK_ERROR_CAUSES_MAX - 1)];
+}
+
+/**
+ * Copy err into slab entry, a formatted message moves with its buffer.
+ */
+static CDK_ECOLD struct cdk_Error *cdk_error_cause_copy(struct cdk_Error *entry,
+                                                       cdk_error_t err) {
+  *entry = *err;
+#if CDK_ERROR_FSTR_ENABLE
+  if (err->msg == err->_msg_buf) {
+    entry->msg = entry->_msg_buf;
+  }
+#endif
+  entry->shared = false;
+  entry->ticket = 0;
+
+  return entry;
+}
+
+/**
+ * Link to err, issuing its ticket on first use. Errors outside the slab are
+ * copied into it first, a NULL err gives an empty link.
+ */
+static inline struct cdk_ECauseLink
+cdk_error_cause_link(struct cdk_ECauses *causes, cdk_error_t err) {
+  uintptr_t at = (uintptr_t)err;
+
+  if (!err) {
+    return (struct cdk_ECauseLink){0};
+  }
+
+  if (at < (uintptr_t)causes->errors ||
+      at >= (uintptr_t)(causes->errors + CDK_ERROR_CAUSES_MAX)) {
+    err = cdk_error_cause_copy(cdk_error_cause_slot(causes), err);
+  }
+
+  if (!err->ticket) {
+    if (++causes->tickets == 0) {
+      causes->tickets = 1;
+    }
+    err->ticket = causes->tickets;
+  }
+
+  return (struct cdk_ECauseLink){.ptr = err, .ticket = err->ticket};
+}
+
+/**
+ * Link freshly created err to cause.
+ */
+static inline cdk_error_t cdk_error_caused(cdk_error_t err,
+                                           struct cdk_ECauseLink cause) {
+  err->cause = cause;
+
+  return err;
+}
+#endif
+
+/**
+ * Errno description.
+ */
+struct cdk_EErrnoDesc {
+  const char *name; // Symbolic name, like "EINVAL"
+  const char *desc; // Description, as glibc strerror
+};
+
+#define CDK_EERRNO_DESC_(code, description)                                    \
+  [code] = {.name = #code, .desc = description}
+
+/*
+ * Errno descriptions indexed by code. Lookup needs no locale, no formatting
+ * and no locks, so dumps from many threads never contend.
+ */
+static const struct cdk_EErrnoDesc cdk_eerrno_descs[] = {
+    [0] = {.name = NULL, .desc = "Success"},
+#ifdef EPERM
+    CDK_EERRNO_DESC_(EPERM, "Operation not permitted"),
+#endif
+#ifdef ENOENT
+    CDK_EERRNO_DESC_(ENOENT, "No such file or directory"),
+#endif
+#ifdef ESRCH
+    CDK_EERRNO_DESC_(ESRCH, "No such process"),
+#endif
+#ifdef EINTR
+    CDK_EERRNO_DESC_(EINTR, "Interrupted system call"),
+#endif
+#ifdef EIO
+    CDK_EERRNO_DESC_(EIO, "Input/output error"),
+#endif
+#ifdef ENXIO
+    CDK_EERRNO_DESC_(ENXIO, "No such device or address"),
+#endif
+#ifdef E2BIG
+    CDK_EERRNO_DESC_(E2BIG, "Argument list too long"),
+#endif
+#ifdef ENOEXEC
+    CDK_EERRNO_DESC_(ENOEXEC, "Exec format error"),
+#endif
+#ifdef EBADF
+    CDK_EERRNO_DESC_(EBADF, "Bad file descriptor"),
+#endif
+#ifdef ECHILD
+    CDK_EERRNO_DESC_(ECHILD, "No child processes"),
+#endif
+#ifdef EAGAIN
+    CDK_EERRNO_DESC_(EAGAIN, "Resource temporarily unavailable"),
+#endif
+#ifdef ENOMEM
+    CDK_EERRNO_DESC_(ENOMEM, "Cannot allocate memory"),
+#endif
+#ifdef EACCES
+    CDK_EERRNO_DESC_(EACCES, "Permission denied"),
+#endif
+#ifdef EFAULT
+    CDK_EERRNO_DESC_(EFAULT, "Bad address"),
+#endif
+#ifdef ENOTBLK
+    CDK_EERRNO_DESC_(ENOTBLK, "Block device required"),
+#endif
+#ifdef EBUSY
+    CDK_EERRNO_DESC_(EBUSY, "Device or resource busy"),
+#endif
+#ifdef EEXIST
+    CDK_EERRNO_DESC_(EEXIST, "File exists"),
+#endif
+#ifdef EXDEV
+    CDK_EERRNO_DESC_(EXDEV, "Invalid cross-device link"),
+#endif
+#ifdef ENODEV
+    CDK_EERRNO_DESC_(ENODEV, "No such device"),
+#endif
+#ifdef ENOTDIR
+    CDK_EERRNO_DESC_(ENOTDIR, "Not a directory"),
+#endif
+#ifdef EISDIR
+    CDK_EERRNO_DESC_(EISDIR, "Is a directory"),
+#endif
+#ifdef EINVAL
+    CDK_EERRNO_DESC_(EINVAL, "Invalid argument"),
+#endif
+#ifdef ENFILE
+    CDK_EERRNO_DESC_(ENFILE, "Too many open files in system"),
+#endif
+#ifdef EMFILE
+    CDK_EERRNO_DESC_(EMFILE, "Too many open files"),
+#endif
+#ifdef ENOTTY
+    CDK_EERRNO_DESC_(ENOTTY, "Inappropriate ioctl for device"),
+#endif
+#ifdef ETXTBSY
+    CDK_EERRNO_DESC_(ETXTBSY, "Text file busy"),
+#endif
+#ifdef EFBIG
+    CDK_EERRNO_DESC_(EFBIG, "File too large"),
+#endif
+#ifdef ENOSPC
+    CDK_EERRNO_DESC_(ENOSPC, "No space left on device"),
+#endif
+#ifdef ESPIPE
+    CDK_EERRNO_DESC_(ESPIPE, "Illegal seek"),
+#endif
+#ifdef EROFS
+    CDK_EERRNO_DESC_(EROFS, "Read-only file system"),
+#endif
+#ifdef EMLINK
+    CDK_EERRNO_DESC_(EMLINK, "Too many links"),
+#endif
+#ifdef EPIPE
+    CDK_EERRNO_DESC_(EPIPE, "Broken pipe"),
+#endif
+#ifdef EDOM
+    CDK_EERRNO_DESC_(EDOM, "Numerical argument out of domain"),
+#endif
+#ifdef ERANGE
+    CDK_EERRNO_DESC_(ERANGE, "Numerical result out of range"),
+#endif
+#ifdef EDEADLK
+    CDK_EERRNO_DESC_(EDEADLK, "Resource deadlock avoided"),
+#endif
+#ifdef ENAMETOOLONG
+    CDK_EERRNO_DESC_(ENAMETOOLONG, "File name too long"),
+#endif
+#ifdef ENOLCK
+    CDK_EERRNO_DESC_(ENOLCK, "No locks available"),
+#endif
+#ifdef ENOSYS
+    CDK_EERRNO_DESC_(ENOSYS, "Function not implemented"),
+#endif
+#ifdef ENOTEMPTY
+    CDK_EERRNO_DESC_(ENOTEMPTY, "Directory not empty"),
+#endif
+#ifdef ELOOP
+    CDK_EERRNO_DESC_(ELOOP, "Too many levels of symbolic links"),
+#endif
+#ifdef ENOMSG
+    CDK_EERRNO_DESC_(ENOMSG, "No message of desired type"),
+#endif
+#ifdef EIDRM
+    CDK_EERRNO_DESC_(EIDRM, "Identifier removed"),
+#endif
+#ifdef ECHRNG
+    CDK_EERRNO_DESC_(ECHRNG, "Channel number out of range"),
+#endif
+#ifdef EL2NSYNC
+    CDK_EERRNO_DESC_(EL2NSYNC, "Level 2 not synchronized"),
+#endif
+#ifdef EL3HLT
+    CDK_EERRNO_DESC_(EL3HLT, "Level 3 halted"),
+#endif
+#ifdef EL3RST
+    CDK_EERRNO_DESC_(EL3RST, "Level 3 reset"),
+#endif
+#ifdef ELNRNG
+    CDK_EERRNO_DESC_(ELNRNG, "Link number out of range"),
+#endif
+#ifdef EUNATCH
+    CDK_EERRNO_DESC_(EUNATCH, "Protocol driver not attached"),
+#endif
+#ifdef ENOCSI
+    CDK_EERRNO_DESC_(ENOCSI, "No CSI structure available"),
+#endif
+#ifdef EL2HLT
+    CDK_EERRNO_DESC_(EL2HLT, "Level 2 halted"),
+#endif
+#ifdef EBADE
+    CDK_EERRNO_DESC_(EBADE, "Invalid exchange"),
+#endif
+#ifdef EBADR
+    CDK_EERRNO_DESC_(EBADR, "Invalid request descriptor"),
+#endif
+#ifdef EXFULL
+    CDK_EERRNO_DESC_(EXFULL, "Exchange full"),
+#endif
+#ifdef ENOANO
+    CDK_EERRNO_DESC_(ENOANO, "No anode"),
+#endif
+#ifdef EBADRQC
+    CDK_EERRNO_DESC_(EBADRQC, "Invalid request code"),
+#endif
+#ifdef EBADSLT
+    CDK_EERRNO_DESC_(EBADSLT, "Invalid slot"),
+#endif
+#ifdef EBFONT
+    CDK_EERRNO_DESC_(EBFONT, "Bad font file format"),
+#endif
+#ifdef ENOSTR
+    CDK_EERRNO_DESC_(ENOSTR, "Device not a stream"),
+#endif
+#ifdef ENODATA
+    CDK_EERRNO_DESC_(ENODATA, "No data available"),
+#endif
+#ifdef ETIME
+    CDK_EERRNO_DESC_(ETIME, "Timer expired"),
+#endif
+#ifdef ENOSR
+    CDK_EERRNO_DESC_(ENOSR, "Out of streams resources"),
+#endif
+#ifdef ENONET
+    CDK_EERRNO_DESC_(ENONET, "Machine is not on the network"),
+#endif
+#ifdef ENOPKG
+    CDK_EERRNO_DESC_(ENOPKG, "Package not installed"),
+#endif
+#ifdef EREMOTE
+    CDK_EERRNO_DESC_(EREMOTE, "Object is remote"),
+#endif
+#ifdef ENOLINK
+    CDK_EERRNO_DESC_(ENOLINK, "Link has been severed"),
+#endif
+#ifdef EADV
+    CDK_EERRNO_DESC_(EADV, "Advertise error"),
+#endif
+#ifdef ESRMNT
+    CDK_EERRNO_DESC_(ESRMNT, "Srmount error"),
+#endif
+#ifdef ECOMM
+    CDK_EERRNO_DESC_(ECOMM, "Communication error on send"),
+#endif
+#ifdef EPROTO
+    CDK_EERRNO_DESC_(EPROTO, "Protocol error"),
+#endif
+#ifdef EMULTIHOP
+    CDK_EERRNO_DESC_(EMULTIHOP, "Multihop attempted"),
+#endif
+#ifdef EDOTDOT
+    CDK_EERRNO_DESC_(EDOTDOT, "RFS specific error"),
+#endif
+#ifdef EBADMSG
+    CDK_EERRNO_DESC_(EBADMSG, "Bad message"),
+#endif
+#ifdef EOVERFLOW
+    CDK_EERRNO_DESC_(EOVERFLOW, "Value too large for defined data type"),
+#endif
+#ifdef ENOTUNIQ
+    CDK_EERRNO_DESC_(ENOTUNIQ, "Name not unique on network"),
+#endif
+#ifdef EBADFD
+    CDK_EERRNO_DESC_(EBADFD, "File descriptor in bad state"),
+#endif
+#ifdef EREMCHG
+    CDK_EERRNO_DESC_(EREMCHG, "Remote address changed"),
+#endif
+#ifdef ELIBACC
+    CDK_EERRNO_DESC_(ELIBACC, "Can not access a needed shared library"),
+#endif
+#ifdef ELIBBAD
+    CDK_EERRNO_DESC_(ELIBBAD, "Accessing a corrupted shared library"),
+#endif
+#ifdef ELIBSCN
+    CDK_EERRNO_DESC_(ELIBSCN, ".lib section in a.out corrupted"),
+#endif
+#ifdef ELIBMAX
+    CDK_EERRNO_DESC_(ELIBMAX,
+                     "Attempting to link in too many shared libraries"),
+#endif
+#ifdef ELIBEXEC
+    CDK_EERRNO_DESC_(ELIBEXEC, "Cannot exec a shared library directly"),
+#endif
+#ifdef EILSEQ
+    CDK_EERRNO_DESC_(EILSEQ,
+                     "Invalid or incomplete multibyte or wide character"),
+#endif
+#ifdef ERESTART
+    CDK_EERRNO_DESC_(ERESTART, "Interrupted system call should be restarted"),
+#endif
+#ifdef ESTRPIPE
+    CDK_EERRNO_DESC_(ESTRPIPE, "Streams pipe error"),
+#endif
+#ifdef EUSERS
+    CDK_EERRNO_DESC_(EUSERS, "Too many users"),
+#endif
+#ifdef ENOTSOCK
+    CDK_EERRNO_DESC_(ENOTSOCK, "Socket operation on non-socket"),
+#endif
+#ifdef EDESTADDRREQ
+    CDK_EERRNO_DESC_(EDESTADDRREQ, "Destination address required"),
+#endif
+#ifdef EMSGSIZE
+    CDK_EERRNO_DESC_(EMSGSIZE, "Message too long"),
+#endif
+#ifdef EPROTOTYPE
+    CDK_EERRNO_DESC_(EPROTOTYPE, "Protocol wrong type for socket"),
+#endif
+#ifdef ENOPROTOOPT
+    CDK_EERRNO_DESC_(ENOPROTOOPT, "Protocol not available"),
+#endif
+#ifdef EPROTONOSUPPORT
+    CDK_EERRNO_DESC_(EPROTONOSUPPORT, "Protocol not supported"),
+#endif
+#ifdef ESOCKTNOSUPPORT
+    CDK_EERRNO_DESC_(ESOCKTNOSUPPORT, "Socket type not supported"),
+#endif
+#ifdef EOPNOTSUPP
+    CDK_EERRNO_DESC_(EOPNOTSUPP, "Operation not supported"),
+#endif
+#ifdef EPFNOSUPPORT
+    CDK_EERRNO_DESC_(EPFNOSUPPORT, "Protocol family not supported"),
+#endif
+#ifdef EAFNOSUPPORT
+    CDK_EERRNO_DESC_(EAFNOSUPPORT, "Address family not supported by protocol"),
+#endif
+#ifdef EADDRINUSE
+    CDK_EERRNO_DESC_(EADDRINUSE, "Address already in use"),
+#endif
+#ifdef EADDRNOTAVAIL
+    CDK_EERRNO_DESC_(EADDRNOTAVAIL, "Cannot assign requested address"),
+#endif
+#ifdef ENETDOWN
+    CDK_EERRNO_DESC_(ENETDOWN, "Network is down"),
+#endif
+#ifdef ENETUNREACH
+    CDK_EERRNO_DESC_(ENETUNREACH, "Network is unreachable"),
+#endif
+#ifdef ENETRESET
+    CDK_EERRNO_DESC_(ENETRESET, "Network dropped connection on reset"),
+#endif
+#ifdef ECONNABORTED
+    CDK_EERRNO_DESC_(ECONNABORTED, "Software caused connection abort"),
+#endif
+#ifdef ECONNRESET
+    CDK_EERRNO_DESC_(ECONNRESET, "Connection reset by peer"),
+#endif
+#ifdef ENOBUFS
+    CDK_EERRNO_DESC_(ENOBUFS, "No buffer space available"),
+#endif
+#ifdef EISCONN
+    CDK_EERRNO_DESC_(EISCONN, "Transport endpoint is already connected"),
+#endif
+#ifdef ENOTCONN
+    CDK_EERRNO_DESC_(ENOTCONN, "Transport endpoint is not connected"),
+#endif
+#ifdef ESHUTDOWN
+    CDK_EERRNO_DESC_(ESHUTDOWN,
+                     "Cannot send after transport endpoint shutdown"),
+#endif
+#ifdef ETOOMANYREFS
+    CDK_EERRNO_DESC_(ETOOMANYREFS, "Too many references: cannot splice"),
+#endif
+#ifdef ETIMEDOUT
+    CDK_EERRNO_DESC_(ETIMEDOUT, "Connection timed out"),
+#endif
+#ifdef ECONNREFUSED
+    CDK_EERRNO_DESC_(ECONNREFUSED, "Connection refused"),
+#endif
+#ifdef EHOSTDOWN
+    CDK_EERRNO_DESC_(EHOSTDOWN, "Host is down"),
+#endif
+#ifdef EHOSTUNREACH
+    CDK_EERRNO_DESC_(EHOSTUNREACH, "No route to host"),
+#endif
+#ifdef EALREADY
+    CDK_EERRNO_DESC_(EALREADY, "Operation already in progress"),
+#endif
+#ifdef EINPROGRESS
+    CDK_EERRNO_DESC_(EINPROGRESS, "Operation now in progress"),
+#endif
+#ifdef ESTALE
+    CDK_EERRNO_DESC_(ESTALE, "Stale file handle"),
+#endif
+#ifdef EUCLEAN
+    CDK_EERRNO_DESC_(EUCLEAN, "Structure needs cleaning"),
+#endif
+#ifdef ENOTNAM
+    CDK_EERRNO_DESC_(ENOTNAM, "Not a XENIX named type file"),
+#endif
+#ifdef ENAVAIL
+    CDK_EERRNO_DESC_(ENAVAIL, "No XENIX semaphores available"),
+#endif
+#ifdef EISNAM
+    CDK_EERRNO_DESC_(EISNAM, "Is a named type file"),
+#endif
+#ifdef EREMOTEIO
+    CDK_EERRNO_DESC_(EREMOTEIO, "Remote I/O error"),
+#endif
+#ifdef EDQUOT
+    CDK_EERRNO_DESC_(EDQUOT, "Disk quota exceeded"),
+#endif
+#ifdef ENOMEDIUM
+    CDK_EERRNO_DESC_(ENOMEDIUM, "No medium found"),
+#endif
+#ifdef EMEDIUMTYPE
+    CDK_EERRNO_DESC_(EMEDIUMTYPE, "Wrong medium type"),
+#endif
+#ifdef ECANCELED
+    CDK_EERRNO_DESC_(ECANCELED, "Operation canceled"),
+#endif
+#ifdef ENOKEY
+    CDK_EERRNO_DESC_(ENOKEY, "Required key not available"),
+#endif
+#ifdef EKEYEXPIRED
+    CDK_EERRNO_DESC_(EKEYEXPIRED, "Key has expired"),
+#endif
+#ifdef EKEYREVOKED
+    CDK_EERRNO_DESC_(EKEYREVOKED, "Key has been revoked"),
+#endif
+#ifdef EKEYREJECTED
+    CDK_EERRNO_DESC_(EKEYREJECTED, "Key was rejected by service"),
+#endif
+#ifdef EOWNERDEAD
+    CDK_EERRNO_DESC_(EOWNERDEAD, "Owner died"),
+#endif
+#ifdef ENOTRECOVERABLE
+    CDK_EERRNO_DESC_(ENOTRECOVERABLE, "State not recoverable"),
+#endif
+#ifdef ERFKILL
+    CDK_EERRNO_DESC_(ERFKILL, "Operation not possible due to RF-kill"),
+#endif
+#ifdef EHWPOISON
+    CDK_EERRNO_DESC_(EHWPOISON, "Memory page has hardware error"),
+#endif
+};
+
+#undef CDK_EERRNO_DESC_
+
+/**
+ * Get errno description, NULL if code is unknown.
+ */
+static inline const char *cdk_error_desc(uint16_t code) {
+  if (code >= sizeof(cdk_eerrno_descs) / sizeof(cdk_eerrno_descs[0])) {
+    return NULL;
+  }
+
+  return cdk_eerrno_descs[code].desc;
+}
+
+/**
+ * Get errno symbolic name, like "EINVAL". NULL if code is unknown.
+ */
+static inline const char *cdk_error_name(uint16_t code) {
+  if (code >= sizeof(cdk_eerrno_descs) / sizeof(cdk_eerrno_descs[0])) {
+    return NULL;
+  }
+
+  return cdk_eerrno_descs[code].name;
+}
+
+/**
+ * Bounded string writer used by dumps, it never formats through stdio.
+ * With fd set, full buffer is flushed with write(2) instead of truncated.
+ * Writer only uses async-signal-safe functions.
+ */
+struct cdk_EWriter {
+  char *buf;
+  size_t size;
+  size_t offset;
+  bool overflow; // Output truncated, or write(2) failed
+  int fd;        // Flush target, -1 for none
+};
+
+static inline void cdk_ewriter_flush(struct cdk_EWriter *w) {
+#ifdef CDK_EPOSIX_
+  size_t done = 0;
+
+  while (done < w->offset) {
+    ssize_t written = write(w->fd, w->buf + done, w->offset - done);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      w->overflow = true;
+      break;
+    }
+    done += written;
+  }
+#else
+  w->overflow = true; // No file descriptors to flush to
+#endif
+
+  w->offset = 0;
+}
+
+static inline void cdk_ewriter_put(struct cdk_EWriter *w, const char *str,
+                                   size_t len) {
+  size_t room = w->size > w->offset ? w->size - w->offset - 1 : 0;
+
+  while (len > room && w->fd >= 0 && w->size > 1) {
+    memcpy(w->buf + w->offset, str, room);
+    w->offset += room;
+    str += room;
+    len -= room;
+    cdk_ewriter_flush(w);
+    room = w->size - 1;
+  }
+
+  if (len > room) {
+    len = room;
+    w->overflow = true;
+  }
+
+  if (len) {
+    memcpy(w->buf + w->offset, str, len);
+    w->offset += len;
+  }
+}
+
+#define cdk_ewriter_lit(w, str) cdk_ewriter_put((w), (str), sizeof(str) - 1)
+
+static inline void cdk_ewriter_puts(struct cdk_EWriter *w, const char *str) {
+  if (!str) {
+    cdk_ewriter_lit(w, "(null)");
+    return;
+  }
+
+  cdk_ewriter_put(w, str, strlen(str));
+}
+
+/**
+ * Write value in decimal, zero padded to at least min_digits.
+ */
+static inline void cdk_ewriter_putu(struct cdk_EWriter *w, uint64_t value,
+                                    int min_digits) {
+  char digits[20];
+  char *pos = digits + sizeof(digits);
+
+  do {
+    *--pos = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  while (digits + sizeof(digits) - pos < min_digits && pos > digits) {
+    *--pos = '0';
+  }
+
+  cdk_ewriter_put(w, pos, digits + sizeof(digits) - pos);
+}
+
+/**
+ * Write value in hexadecimal with 0x prefix.
+ */
+static inline void cdk_ewriter_putx(struct cdk_EWriter *w, uint64_t value) {
+  char digits[18];
+  char *pos = digits + sizeof(digits);
+
+  do {
+    *--pos = "0123456789abcdef"[value & 0xf];
+    value >>= 4;
+  } while (value);
+  *--pos = 'x';
+  *--pos = '0';
+
+  cdk_ewriter_put(w, pos, digits + sizeof(digits) - pos);
+}
+
+/**
+ * Terminate written string, return ENOBUFS if it did not fit.
+ */
+static inline int cdk_ewriter_end(struct cdk_EWriter *w) {
+  if (w->size == 0) {
+    return ENOBUFS;
+  }
+
+  w->buf[w->offset < w->size ? w->offset : w->size - 1] = 0;
+
+  return w->overflow ? ENOBUFS : 0;
+}
+
+static inline void cdk_error_write_dropped(struct cdk_EWriter *w,
+                                           size_t dropped) {
+  cdk_ewriter_lit(w, "   ... ");
+  cdk_ewriter_putu(w, dropped, 1);
+  if (dropped == 1) {
+    cdk_ewriter_lit(w, " frame dropped ...\n");
+  } else {
+    cdk_ewriter_lit(w, " frames dropped ...\n");
+  }
+}
+
+static inline void cdk_error_write_body(struct cdk_EWriter *w,
+                                        const struct cdk_Error *err) {
+  size_t eframes_len = err->eframes_len < CDK_ERROR_BTRACE_MAX
+                           ? err->eframes_len
+                           : CDK_ERROR_BTRACE_MAX;
+
+  cdk_ewriter_lit(w, "Error code: ");
+  cdk_ewriter_putu(w, err->code, 1);
+  cdk_ewriter_lit(w, "\nError desc: ");
+  const char *desc = cdk_error_desc(err->code);
+  if (desc) {
+    cdk_ewriter_puts(w, desc);
+  } else {
+    cdk_ewriter_lit(w, "Unknown error ");
+    cdk_ewriter_putu(w, err->code, 1);
+  }
+  cdk_ewriter_lit(w, "\n");
+#ifdef CDK_ERROR_DUMP_ERRNO_NAME
+  const char *name = cdk_error_name(err->code);
+  if (name) {
+    cdk_ewriter_lit(w, "Error name: ");
+    cdk_ewriter_puts(w, name);
+    cdk_ewriter_lit(w, "\n");
+  }
+#endif
+
+  if (err->type > cdk_ErrorType_INT) {
+    cdk_ewriter_lit(w, "------------------------\n");
+  }
+
+  switch (err->type) {
+  case cdk_ErrorType_STR:
+#if CDK_ERROR_FSTR_ENABLE && defined(CDK_ERROR_DEFER_FSTR)
+  case cdk_ErrorType_FSTR_LAZY: // Format itself, arguments are not rendered
+#endif
+    cdk_ewriter_lit(w, " Error msg: ");
+    cdk_ewriter_puts(w, err->msg);
+    cdk_ewriter_lit(w, "\n");
+    break;
+
+#if CDK_ERROR_FSTR_ENABLE
+  case cdk_ErrorType_FSTR: {
+    const char *end = memchr(err->msg, 0, sizeof(err->_msg_buf));
+    cdk_ewriter_lit(w, " Error msg: ");
+    cdk_ewriter_put(w, err->msg,
+                    end ? (size_t)(end - err->msg) : sizeof(err->_msg_buf));
+    cdk_ewriter_lit(w, "\n");
+    break;
+  }
+#endif
+  default:;
+  }
+
+  cdk_ewriter_lit(w, "------------------------\n"
+                     " Backtrace:\n");
+
+  for (size_t i = 0; i < eframes_len; i++) {
+    size_t slot = cdk_eframe_slot(eframes_len, err->eframes_dropped, i);
+    struct cdk_ESite site = cdk_error_site(err, &err->eframes[slot]);
+    size_t depth = i;
+
+    if (err->eframes_dropped && i >= CDK_ERROR_BTRACE_HEAD) {
+      if (i == CDK_ERROR_BTRACE_HEAD) {
+        cdk_error_write_dropped(w, err->eframes_dropped);
+      }
+      depth += err->eframes_dropped;
+    }
+    cdk_ewriter_lit(w, "   [");
+    cdk_ewriter_putu(w, depth, 2);
+    cdk_ewriter_lit(w, "] ");
+    cdk_ewriter_puts(w, site.file);
+    cdk_ewriter_lit(w, ":");
+    cdk_ewriter_puts(w, site.func);
+    cdk_ewriter_lit(w, ":");
+    cdk_ewriter_putu(w, site.line, 1);
+#ifdef CDK_ERROR_COLLAPSE
+    if (err->eframes[slot].repeat) {
+      cdk_ewriter_lit(w, " (x");
+      cdk_ewriter_putu(w, err->eframes[slot].repeat + 1ull, 1);
+      cdk_ewriter_lit(w, ")");
+    }
+#endif
+    cdk_ewriter_lit(w, "\n");
+  }
+
+  // Newest frames were dropped if the limit left no room past the head.
+  if (err->eframes_dropped && eframes_len <= CDK_ERROR_BTRACE_HEAD) {
+    cdk_error_write_dropped(w, err->eframes_dropped);
+  }
+}
+
+#ifdef CDK_ERROR_FRAME_POINTERS
+/**
+ * Write return addresses of err. Only string dumps resolve them, a writer with
+ * fd set stays async-signal-safe and writes raw addresses.
+ */
+static inline void cdk_error_write_addrs(struct cdk_EWriter *w,
+                                         cdk_error_t err) {
+  size_t eaddrs_len =
+      err->eaddrs_len < CDK_ERROR_FP_MAX ? err->eaddrs_len : CDK_ERROR_FP_MAX;
+
+  if (eaddrs_len == 0) {
+    return;
+  }
+
+  cdk_ewriter_lit(w, "------------------------\n"
+                     " Call stack:\n");
+  for (size_t i = 0; i < eaddrs_len; i++) {
+    struct cdk_ESymbol symbol = {.addr = err->eaddrs[i]};
+
+    if (w->fd < 0) {
+      symbol = cdk_error_fp_resolve(err->eaddrs[i]);
+    }
+    cdk_ewriter_lit(w, "   [");
+    cdk_ewriter_putu(w, i, 2);
+    cdk_ewriter_lit(w, "] ");
+    if (symbol.name) {
+      cdk_ewriter_puts(w, symbol.name);
+      cdk_ewriter_lit(w, "+");
+      cdk_ewriter_putx(w, symbol.offset);
+      cdk_ewriter_lit(w, " (");
+      cdk_ewriter_puts(w, symbol.module);
+      cdk_ewriter_lit(w, ")");
+    } else if (symbol.module) {
+      cdk_ewriter_puts(w, symbol.module);
+      cdk_ewriter_lit(w, "+");
+      cdk_ewriter_putx(w, symbol.offset);
+    } else {
+      cdk_ewriter_putx(w, (uintptr_t)symbol.addr);
+    }
+    cdk_ewriter_lit(w, "\n");
+  }
+}
+#endif
+
+/**
+ * Write dump of err and its causes. Reads at most CDK_ERROR_BTRACE_MAX frames
+ * and never formats deferred messages, so it works on a half-written error too.
+ */
+static inline void cdk_error_write(struct cdk_EWriter *w, cdk_error_t err) {
+  cdk_ewriter_lit(w, "====== ERROR DUMP ======\n");
+  cdk_error_write_body(w, err);
+#ifdef CDK_ERROR_FRAME_POINTERS
+  cdk_error_write_addrs(w, err);
+#endif
+
+#ifdef CDK_ERROR_CAUSES
+  const struct cdk_ECauseLink *link = &err->cause;
+
+  // Bounded, so a link torn by a signal handler cannot loop forever.
+  for (size_t i = 0; i <= CDK_ERROR_CAUSES_MAX && link->ptr; i++) {
+    const struct cdk_Error *cause = cdk_ecause_get(link);
+    if (!cause) {
+      cdk_ewriter_lit(w, "====== CAUSED BY =======\n"
+                         " Cause dropped, raise CDK_ERROR_CAUSES_MAX\n");
+      break;
+    }
+
+    cdk_ewriter_lit(w, "====== CAUSED BY =======\n");
+    cdk_error_write_body(w, cause);
+    link = &cause->cause;
+  }
+#endif
+}
+
+/**
+ * Dump all struct cdk_XError to string.
+ */
+static inline int cdk_error_dumps(cdk_error_t err, size_t buf_size, char *buf) {
+  struct cdk_EWriter w = {.buf = buf, .size = buf_size, .fd = -1};
+
+#if CDK_ERROR_FSTR_ENABLE && defined(CDK_ERROR_DEFER_FSTR)
+  cdk_error_render(err);
+#ifdef CDK_ERROR_CAUSES
+  // Causes are linked in place and are never static, so they are writable.
+  const struct cdk_Error *cause = cdk_error_cause(err);
+  for (size_t i = 0; i < CDK_ERROR_CAUSES_MAX && cause; i++) {
+    cdk_error_render((cdk_error_t)cause);
+    cause = cdk_ecause_get(&cause->cause);
+  }
+#endif
+#endif
+
+  cdk_error_write(&w, err);
+
+  return cdk_ewriter_end(&w);
+}
+
+#ifdef CDK_EPOSIX_
+/**
+ * Dump struct cdk_Error to file descriptor. Async-signal-safe, uses only
+ * write(2) and preserves errno, so it can be called from a crash handler.
+ * Deferred messages are written as their format.
+ */
+static inline int cdk_error_dumpfd(cdk_error_t err, int fd) {
+  char buf[256];
+  struct cdk_EWriter w = {.buf = buf, .size = sizeof(buf), .fd = fd};
+  int saved_errno = errno;
+
+  cdk_error_write(&w, err);
+  cdk_ewriter_flush(&w);
+
+  errno = saved_errno;
+
+  return w.overflow ? EIO : 0;
+}
+#endif
+
+/**
+ * Put frame into the ring past CDK_ERROR_BTRACE_HEAD in place of its oldest
+ * frame. Without such ring the frame itself is dropped.
+ */
+static inline void cdk_error_rotate_frame(cdk_error_t err,
+                                          struct cdk_EFrame *frame) {
+  if (err->eframes_len > CDK_ERROR_BTRACE_HEAD) {
+    err->eframes[CDK_ERROR_BTRACE_HEAD +
+                 err->eframes_dropped %
+                     (err->eframes_len - CDK_ERROR_BTRACE_HEAD)] = *frame;
+  }
+  err->eframes_dropped++;
+}
+
+/**
+ * Append frame to err, rotating it in once err is full. Errors which are not
+ * sampled and static errors, which are read-only, are left untouched. Promote
+ * static errors with cdk_error_promote first.
+ */
+static inline void cdk_error_add_frame(cdk_error_t err,
+                                       struct cdk_EFrame *frame) {
+  if (err->no_trace) {
+    return;
+  }
+#ifdef CDK_ERROR_SITE_IDS
+  // Id from another object's table would resolve to an unrelated site.
+  if (err->esites != __start_cdk_esites) {
+    return;
+  }
+#endif
+
+#ifdef CDK_ERROR_DEPTH
+  // Limit is 0 until this thread's first wrap reads the environment.
+  size_t max = cdk_hidden_edepth ? cdk_hidden_edepth : cdk_error_depth_init();
+#else
+  size_t max = CDK_ERROR_BTRACE_MAX;
+#endif
+#ifdef CDK_ERROR_COLLAPSE
+  struct cdk_EFrame *last = cdk_error_last_frame(err);
+
+  if (last && cdk_eframe_same(last, frame)) {
+    last->repeat += last->repeat < UINT32_MAX;
+    return;
+  }
+#endif
+
+  // Once frames were dropped the length stays, raising the limit cannot
+  // reorder the ring.
+  if (err->eframes_len >= max || err->eframes_dropped) {
+    cdk_error_rotate_frame(err, frame);
+    return;
+  }
+  err->eframes[err->eframes_len++] = *frame;
+}
+
+#ifdef CDK_ERROR_SHADOW
+/**
+ * Append frames of the callers of a function at shadow depth `depth` to err,
+ * innermost first, as cdk_error_wrap would.
+ */
+static CDK_ECOLD cdk_error_t cdk_error_shadow_copy(cdk_error_t err,
+                                                   size_t depth) {
+  const struct cdk_EShadow *shadow = &cdk_hidden_eshadow;
+  size_t len = shadow->len < depth ? shadow->len : depth;
+
+  len = len < CDK_ERROR_SHADOW_MAX ? len : CDK_ERROR_SHADOW_MAX;
+  for (size_t i = len; i > 0 && !err->no_trace; i--) {
+    struct cdk_EFrame frame = shadow->frames[CDK_ERROR_SHADOW_MAX - i];
+
+    cdk_error_add_frame(err, &frame);
+  }
+
+  return err;
+}
+
+#define cdk_error_shadowed_(err) cdk_error_shadow_copy((err), cdk_eshadow_depth)
+#else
+#define cdk_error_shadowed_(err) (err)
+#endif
+
+#if CDK_ERROR_BTRACE_ENABLE
+/**
+ * Activation of a CDK_FRAME scope, with the error whose newest frame it added.
+ */
+struct cdk_EScope {
+  const struct cdk_ESite *site; // Frame added when the scope is left
+  const struct cdk_Error *err;  // Error created or wrapped here, NULL if none
+  size_t len;                   // Its frame count right after
+  size_t dropped;               // Its dropped count right after
+};
+
+/*
+ * Scope of the enclosing CDK_FRAME, shadowed by the one it declares. Errors
+ * created and wrapped outside of such function note nothing.
+ */
+static struct cdk_EScope *const cdk_escope __attribute__((unused)) = NULL;
+
+/**
+ * Note that the activation of scope added the newest frame of err.
+ */
+static inline cdk_error_t cdk_escope_note(struct cdk_EScope *scope,
+                                          cdk_error_t err) {
+  if (scope) {
+    scope->err = err;
+    scope->len = err->eframes_len;
+    scope->dropped = err->eframes_dropped;
+  }
+
+  return err;
+}
+
+/**
+ * Drop the note of scope, its slot may hold an unrelated error next.
+ */
+static inline void cdk_escope_forget(struct cdk_EScope *scope) {
+  if (scope) {
+    scope->err = NULL;
+  }
+}
+
+#define cdk_escope_noted_(err) cdk_escope_note(cdk_escope, (err))
+#else
+#define cdk_escope_noted_(err) (err)
+#define cdk_escope_forget(scope) ((void)0)
+#endif
+
+/**
+ * Copy static err into writable slot so it can be wrapped. Any other error is
+ * returned as it is and slot is not touched.
+ *
+ * Fields are copied directly rather than through cdk_error_init, so promotion
+ * takes no sampler token, walks no frame pointers and copies no shadow frames.
+ * The copy is always traced.
+ */
+static CDK_ECOLD cdk_error_t cdk_error_promote(cdk_error_t err,
+                                               struct cdk_Error *slot) {
+  if (!err->shared) {
+    return err;
+  }
+
+#ifdef CDK_ERROR_ZERO_INIT
+  *slot = *err;
+#else
+  slot->type = err->type;
+  slot->code = err->code;
+  slot->msg = err->msg;
+  slot->eframes[0] = err->eframes[0];
+  slot->eframes_len = err->eframes_len;
+  slot->eframes_dropped = 0;
+#ifdef CDK_ERROR_SITE_IDS
+  slot->esites = err->esites;
+#endif
+#ifdef CDK_ERROR_CAUSES
+  slot->cause = (struct cdk_ECauseLink){0};
+  slot->ticket = 0;
+#endif
+#ifdef CDK_ERROR_FRAME_POINTERS
+  slot->eaddrs_len = 0;
+#endif
+#endif
+  slot->shared = false;
+  slot->no_trace = false;
+
+  return slot;
+}
+
+#if CDK_ERROR_BTRACE_ENABLE && defined(CDK_ERROR_OUTLINE)
+static CDK_ECOLD cdk_error_t cdk_error_wrap_at(cdk_error_t err,
+                                               CDK_EFRAME_PARAMS) {
+  struct cdk_EFrame frame = CDK_EFRAME_FROM_PARAMS;
+
+  cdk_error_add_frame(err, &frame);
+
+  return err;
+}
+
+#define cdk_error_wrap(err)                                                    \
+  cdk_escope_noted_(cdk_error_wrap_at((err), CDK_EFRAME_HERE))
+#elif CDK_ERROR_BTRACE_ENABLE
+#define cdk_error_wrap(err)                                                    \
+  ({                                                                           \
+    struct cdk_EFrame cdk_eframe_ = {CDK_EFRAME_HERE};                         \
+    cdk_error_add_frame(err, &cdk_eframe_);                                    \
+    cdk_escope_noted_(err);                                                    \
+  })
+#else
+#define cdk_error_wrap(err)
+#endif
+
+#define cdk_error_return(ret, err)                                             \
+  ({                                                                           \
+    cdk_error_wrap(err);                                                       \
+    ret;                                                                       \
+  })
+
+/*
+ * Frames collected after the origin one, then the note for CDK_FRAME.
+ */
+#define cdk_error_created_(err) cdk_escope_noted_(cdk_error_shadowed_(err))
+
+#define cdk_errori(err, code)                                                  \
+  (cdk_ecount(),                                                               \
+   cdk_error_created_(cdk_error_int((err), (code), CDK_EFRAME_HERE)))
+
+#define cdk_errors(err, code, msg)                                             \
+  (cdk_ecount(), cdk_error_created_(                                           \
+                     cdk_error_lstr((err), (code), CDK_EFRAME_HERE, (msg))))
+
+#define cdk_errorf(err, code, fmt, ...)                                        \
+  (cdk_ecount(), cdk_error_created_(cdk_error_fstr(                            \
+                     (err), (code), CDK_EFRAME_HERE, (fmt), ##__VA_ARGS__)))
+
+/*
+ * Static errors are pre-constructed at compile time with a fixed origin frame
+ * and live in read-only memory, so returning one writes nothing and works
+ * without TLS or free memory. They are meant for hot failures like ENOMEM or
+ * EAGAIN which always come from the same place. Each one takes a full
+ * struct cdk_Error of read-only data. With `CDK_ERROR_SITE_IDS` site ids are
+ * known only after linking, so static errors start without frames and a
+ * CDK_FRAME scope adds its own.
+ */
+#ifdef CDK_ERROR_SITE_IDS
+#define CDK_ESTATIC_FRAMES_ .eframes_len = 0, .esites = __start_cdk_esites
+#define cdk_estatic_noted_(err) (err)
+#else
+#define CDK_ESTATIC_FRAMES_                                                    \
+  .eframes = {{CDK_EFRAME_HERE}}, .eframes_len = 1
+#define cdk_estatic_noted_(err) cdk_escope_noted_(err)
+#endif
+
+#define cdk_error_static_(type_, code_, msg_)                                  \
+  ({                                                                           \
+    static const struct cdk_Error cdk_estatic_ = {                             \
+        .type = type_,                                                         \
+        .code = code_,                                                         \
+        .shared = true,                                                        \
+        .no_trace = true,                                                      \
+        .msg = msg_,                                                           \
+        CDK_ESTATIC_FRAMES_,                                                   \
+    };                                                                         \
+    cdk_ecount();                                                              \
+    cdk_estatic_noted_(cdk_error_flight_record((cdk_error_t)&cdk_estatic_));   \
+  })
+
+#define cdk_error_statici(code)                                                \
+  cdk_error_static_(cdk_ErrorType_INT, code, NULL)
+
+#define cdk_error_statics(code, msg)                                           \
+  cdk_error_static_(cdk_ErrorType_STR, code, msg)
+
+#ifdef CDK_ERROR_CAUSES
+/*
+ * Chained constructors return a new error from the slab caused by `cause`,
+ * which is left in place. A NULL cause gives an error without one.
+ */
+#define cdk_error_chain_(causes, cause, create)                                \
+  ({                                                                           \
+    struct cdk_ECauses *cdk_causes_ = (causes);                                \
+    struct cdk_ECauseLink cdk_cause_ =                                         \
+        cdk_error_cause_link(cdk_causes_, (cause));                            \
+    cdk_error_t cdk_err_ = cdk_error_cause_slot(cdk_causes_);                  \
+    cdk_error_caused(create, cdk_cause_);                                      \
+  })
+
+#define cdk_errorci(causes, cause, code)                                       \
+  cdk_error_chain_(causes, cause, cdk_errori(cdk_err_, code))
+
+#define cdk_errorcs(causes, cause, code, msg)                                  \
+  cdk_error_chain_(causes, cause, cdk_errors(cdk_err_, code, msg))
+
+#if CDK_ERROR_FSTR_ENABLE
+#define cdk_errorcf(causes, cause, code, fmt, ...)                             \
+  cdk_error_chain_(causes, cause,                                              \
+                   cdk_errorf(cdk_err_, code, fmt, ##__VA_ARGS__))
+#endif
+#endif
+
+#define CDK_TRY_CATCH(err, label)                                              \
+  if (__builtin_expect(!!(err), 0)) {                                          \
+    cdk_ecount();                                                              \
+    cdk_error_wrap(err);                                                       \
+    goto label;                                                                \
+  }
+#define CDK_TRY(err) CDK_TRY_CATCH(err, error_out)
+
+/******************************************************************************
+ *                                 History                                    *
+ ******************************************************************************/
+/*
+ * Error history is a fixed size ring of errors which were replaced by newer
+ * ones. Saving an error copies its code, message pointer and used frames into
+ * the next slot, there are no locks and no allocations. Formatted messages
+ * are rendered and copied up to CDK_ERROR_HISTORY_MSG_MAX bytes. Deferred
+ * ones keep their format and arguments when the arguments fit into as many
+ * bytes, and are rendered by cdk_error_history_load.
+ */
+_Static_assert((CDK_ERROR_HISTORY_MAX & (CDK_ERROR_HISTORY_MAX - 1)) == 0,
+               "CDK_ERROR_HISTORY_MAX must be a power of two");
+
+/**
+ * Error history record.
+ */
+struct cdk_ERecord {
+  enum cdk_ErrorType type;                         // Error type
+  uint16_t code;                                   // Status code
+  const char *msg;                                 // String msg or format
+  struct cdk_EFrame eframes[CDK_ERROR_BTRACE_MAX]; // Backtrace frames
+  size_t eframes_len;                              // Backtrace frames length
+  size_t eframes_dropped;                          // Frames lost on overflow
+#ifdef CDK_ERROR_SITE_IDS
+  const struct cdk_ESite *esites; // Site table frames index into
+#endif
+
+#if CDK_ERROR_FSTR_ENABLE
+  char _msg_buf[CDK_ERROR_HISTORY_MSG_MAX]; // Formatted message or arguments
+#endif
+};
+
+/**
+ * Error history ring.
+ */
+struct cdk_EHistory {
+  struct cdk_ERecord records[CDK_ERROR_HISTORY_MAX];
+  size_t saved; // Number of records saved since last clear
+};
+
+/**
+ * Save error into history. Errors without frames are not saved.
+ */
+static CDK_ECOLD cdk_error_t
+cdk_error_history_save(struct cdk_EHistory *history, cdk_error_t err) {
+  if (err->eframes_len == 0) {
+    return err;
+  }
+
+  struct cdk_ERecord *record =
+      &history->records[history->saved++ & (CDK_ERROR_HISTORY_MAX - 1)];
+
+  record->type = err->type;
+  record->code = err->code;
+  record->msg = err->msg;
+#if CDK_ERROR_FSTR_ENABLE && defined(CDK_ERROR_DEFER_FSTR)
+  if (err->type == cdk_ErrorType_FSTR_LAZY) {
+    size_t size = cdk_efmt_args_size(err->msg, err->_msg_buf);
+
+    if (size <= sizeof(record->_msg_buf)) {
+      memcpy(record->_msg_buf, err->_msg_buf, size);
+    } else {
+      record->msg = cdk_error_msg(err);
+      record->type = err->type;
+    }
+  }
+#endif
+#if CDK_ERROR_FSTR_ENABLE
+  if (record->type == cdk_ErrorType_FSTR) {
+    size_t max = sizeof(record->_msg_buf) - 1;
+    const char *end = memchr(record->msg, 0, max);
+    size_t len = end ? (size_t)(end - record->msg) : max;
+
+    memcpy(record->_msg_buf, record->msg, len);
+    record->_msg_buf[len] = 0;
+    record->msg = record->_msg_buf;
+  }
+#endif
+  record->eframes_len = err->eframes_len;
+  record->eframes_dropped = err->eframes_dropped;
+#ifdef CDK_ERROR_SITE_IDS
+  record->esites = err->esites;
+#endif
+  memcpy(record->eframes, err->eframes,
+         err->eframes_len * sizeof(err->eframes[0]));
+
+  return err;
+}
+
+/**
+ * Number of records currently held by history.
+ */
+static inline size_t cdk_error_history_len(struct cdk_EHistory *history) {
+  return history->saved < CDK_ERROR_HISTORY_MAX ? history->saved
+                                                : CDK_ERROR_HISTORY_MAX;
+}
+
+/**
+ * Get history record, 0 is the most recent one. NULL if out of range.
+ */
+static inline const struct cdk_ERecord *
+cdk_error_history_get(struct cdk_EHistory *history, size_t i) {
+  if (i >= cdk_error_history_len(history)) {
+    return NULL;
+  }
+
+  return &history->records[(history->saved - 1 - i) &
+                           (CDK_ERROR_HISTORY_MAX - 1)];
+}
+
+static inline void cdk_error_history_clear(struct cdk_EHistory *history) {
+  history->saved = 0;
+}
+
+/**
+ * Load history record into err, to dump it or read its message with
+ * cdk_error_msg. Deferred messages are rendered there, record stays as is.
+ */
+static inline void cdk_error_history_load(struct cdk_Error *err,
+                                          const struct cdk_ERecord *record) {
+  err->type = record->type;
+  err->code = record->code;
+  err->msg = record->msg;
+  err->shared = false;
+  err->no_trace = false;
+#if CDK_ERROR_FSTR_ENABLE
+  // Rendered messages are read in place, up to their terminator.
+  if (record->type == cdk_ErrorType_FSTR) {
+    err->type = cdk_ErrorType_STR;
+  }
+#endif
+#if CDK_ERROR_FSTR_ENABLE && defined(CDK_ERROR_DEFER_FSTR)
+  if (record->type == cdk_ErrorType_FSTR_LAZY) {
+    size_t size = sizeof(record->_msg_buf) < sizeof(err->_msg_buf)
+                      ? sizeof(record->_msg_buf)
+                      : sizeof(err->_msg_buf);
+
+    memcpy(err->_msg_buf, record->_msg_buf, size);
+  }
+#endif
+  err->eframes_len = record->eframes_len;
+  err->eframes_dropped = record->eframes_dropped;
+#ifdef CDK_ERROR_SITE_IDS
+  err->esites = record->esites;
+#endif
+#ifdef CDK_ERROR_FRAME_POINTERS
+  err->eaddrs_len = 0;
+#endif
+  memcpy(err->eframes, record->eframes,
+         record->eframes_len * sizeof(record->eframes[0]));
+#ifdef CDK_ERROR_CAUSES
+  err->cause = (struct cdk_ECauseLink){0};
+#endif
+}
+
+/**
+ * Dump all history records to string, oldest first.
+ */
+static inline int cdk_error_history_dumps(struct cdk_EHistory *history,
+                                          size_t buf_size, char *buf) {
+  struct cdk_Error err;
+  size_t offset = 0;
+  int ret;
+
+  if (buf_size > 0) {
+    buf[0] = 0;
+  }
+
+  for (size_t i = cdk_error_history_len(history); i-- > 0;) {
+    cdk_error_history_load(&err, cdk_error_history_get(history, i));
+
+    ret = cdk_error_dumps(&err, buf_size - offset, buf + offset);
+    if (ret) {
+      return ret;
+    }
+    offset += strlen(buf + offset);
+  }
+
+  return 0;
+}
+
+/******************************************************************************
+ *                                   Batch                                    *
+ ******************************************************************************/
+/*
+ * Batch error set collects every failure of a batch operation without
+ * building a struct cdk_Error per failure. Entries are stored as parallel
+ * arrays (item index, code, site, message pointer) carved out of caller
+ * provided storage, so scans over codes or items touch only what they need.
+ * The library never allocates: when the set fills up further failures are
+ * counted in `dropped` until cdk_error_batch_grow moves it into more room.
+ */
+
+/**
+ * Bytes of storage taken by one batch entry.
+ */
+#define CDK_EBATCH_ENTRY_SIZE                                                  \
+  (sizeof(const char *) + sizeof(struct cdk_EFrame) + sizeof(uint32_t) +       \
+   sizeof(uint16_t))
+
+/**
+ * Batch error set.
+ */
+struct cdk_EBatch {
+  const char **msgs;         // Message per entry, can be NULL
+  struct cdk_EFrame *frames; // Site per entry
+  uint32_t *items;           // Item index per entry
+  uint16_t *codes;           // Status code per entry
+  size_t len;                // Number of entries
+  size_t cap;                // Entries which fit into storage
+  size_t dropped;            // Failures which did not fit
+};
+
+/**
+ * Move batch into new storage, which must not overlap the current one.
+ * Return ENOBUFS if it cannot hold the current entries.
+ */
+static inline int cdk_error_batch_grow(struct cdk_EBatch *batch, void *buf,
+                                       size_t buf_size) {
+  uintptr_t align = sizeof(const char *);
+  uintptr_t start = ((uintptr_t)buf + align - 1) & ~(align - 1);
+  size_t pad = start - (uintptr_t)buf;
+  size_t cap = 0;
+  char *pos = (char *)start;
+
+  // Multiple of 8 keeps every array aligned whatever frame size is.
+  if (buf_size > pad) {
+    cap = (buf_size - pad) / CDK_EBATCH_ENTRY_SIZE & ~(size_t)7;
+  }
+  if (cap == 0 || cap < batch->len) {
+    return ENOBUFS;
+  }
+
+  const char **msgs = (const char **)pos;
+  pos += cap * sizeof(msgs[0]);
+  struct cdk_EFrame *frames = (struct cdk_EFrame *)pos;
+  pos += cap * sizeof(frames[0]);
+  uint32_t *items = (uint32_t *)pos;
+  pos += cap * sizeof(items[0]);
+  uint16_t *codes = (uint16_t *)pos;
+
+  if (batch->len) {
+    memcpy(msgs, batch->msgs, batch->len * sizeof(msgs[0]));
+    memcpy(frames, batch->frames, batch->len * sizeof(frames[0]));
+    memcpy(items, batch->items, batch->len * sizeof(items[0]));
+    memcpy(codes, batch->codes, batch->len * sizeof(codes[0]));
+  }
+
+  batch->msgs = msgs;
+  batch->frames = frames;
+  batch->items = items;
+  batch->codes = codes;
+  batch->cap = cap;
+
+  return 0;
+}
+
+/**
+ * Initialize empty batch in buf. Return ENOBUFS if not even 8 entries fit.
+ */
+static inline int cdk_error_batch_init(struct cdk_EBatch *batch, void *buf,
+                                       size_t buf_size) {
+  *batch = (struct cdk_EBatch){0};
+
+  return cdk_error_batch_grow(batch, buf, buf_size);
+}
+
+static inline int cdk_ebatch_put(struct cdk_EBatch *batch, uint32_t item,
+                                 uint16_t code, const char *msg,
+                                 struct cdk_EFrame frame) {
+  if (batch->len == batch->cap) {
+    batch->dropped++;
+    return ENOBUFS;
+  }
+
+  size_t i = batch->len++;
+  batch->msgs[i] = msg;
+  batch->frames[i] = frame;
+  batch->items[i] = item;
+  batch->codes[i] = code;
+
+  return 0;
+}
+
+/**
+ * Append failure of item. Return ENOBUFS and count it as dropped if full.
+ */
+static inline int cdk_error_batch_push(struct cdk_EBatch *batch, uint32_t item,
+                                       uint16_t code, const char *msg,
+                                       CDK_EFRAME_PARAMS) {
+  return cdk_ebatch_put(batch, item, code, msg, CDK_EFRAME_FROM_PARAMS);
+}
+
+#define cdk_error_batch_add(batch, item, code, msg)                            \
+  (cdk_ecount(),                                                               \
+   cdk_error_batch_push((batch), (item), (code), (msg), CDK_EFRAME_HERE))
+
+/**
+ * Number of entries with code.
+ */
+static inline size_t cdk_error_batch_count(const struct cdk_EBatch *batch,
+                                           uint16_t code) {
+  size_t count = 0;
+
+  for (size_t i = 0; i < batch->len; i++) {
+    count += batch->codes[i] == code;
+  }
+
+  return count;
+}
+
+/**
+ * Find entry of the lowest item index. Return false if batch is empty.
+ */
+static inline bool cdk_error_batch_first(const struct cdk_EBatch *batch,
+                                         size_t *entry) {
+  if (batch->len == 0) {
+    return false;
+  }
+
+  size_t first = 0;
+  for (size_t i = 1; i < batch->len; i++) {
+    if (batch->items[i] < batch->items[first]) {
+      first = i;
+    }
+  }
+  *entry = first;
+
+  return true;
+}
+
+/**
+ * Materialize entry as a regular error in err, with the site as its only
+ * frame. The caller's stack has nothing to do with the entry, so no return
+ * addresses or shadow frames are collected and no sample is taken. Entry has
+ * to be lower than batch->len.
+ */
+static inline cdk_error_t cdk_error_batch_get(const struct cdk_EBatch *batch,
+                                              size_t entry,
+                                              struct cdk_Error *err) {
+  assert(entry < batch->len);
+
+  return cdk_error_init_origin(
+      err, batch->msgs[entry] ? cdk_ErrorType_STR : cdk_ErrorType_INT,
+      batch->codes[entry], batch->msgs[entry], batch->frames[entry], false);
+}
+
+/**
+ * Dump batch to string, one line per entry:
+ * `[item] code file:func:line msg`.
+ */
+static inline int cdk_error_batch_dumps(const struct cdk_EBatch *batch,
+                                        size_t buf_size, char *buf) {
+  struct cdk_EWriter w = {.buf = buf, .size = buf_size, .fd = -1};
+
+  cdk_ewriter_lit(&w, "====== BATCH DUMP ======\n"
+                      "Failures: ");
+  cdk_ewriter_putu(&w, batch->len, 1);
+  if (batch->dropped) {
+    cdk_ewriter_lit(&w, " (+");
+    cdk_ewriter_putu(&w, batch->dropped, 1);
+    cdk_ewriter_lit(&w, " dropped)");
+  }
+  cdk_ewriter_lit(&w, "\n------------------------\n");
+
+  for (size_t i = 0; i < batch->len; i++) {
+    struct cdk_ESite site = cdk_eframe_site(&batch->frames[i]);
+    cdk_ewriter_lit(&w, "   [");
+    cdk_ewriter_putu(&w, batch->items[i], 1);
+    cdk_ewriter_lit(&w, "] ");
+    cdk_ewriter_putu(&w, batch->codes[i], 1);
+    cdk_ewriter_lit(&w, " ");
+    cdk_ewriter_puts(&w, site.file);
+    cdk_ewriter_lit(&w, ":");
+    cdk_ewriter_puts(&w, site.func);
+    cdk_ewriter_lit(&w, ":");
+    cdk_ewriter_putu(&w, site.line, 1);
+    if (batch->msgs[i]) {
+      cdk_ewriter_lit(&w, " ");
+      cdk_ewriter_puts(&w, batch->msgs[i]);
+    }
+    cdk_ewriter_lit(&w, "\n");
+  }
+
+  return cdk_ewriter_end(&w);
+}
+
+#ifdef CDK_ERROR_SCAN
+/******************************************************************************
+ *                                Status scan                                 *
+ ******************************************************************************/
+/*
+ * Status scan looks for failures in arrays of int32_t results, where a
+ * negative value is -errno as returned by batched syscalls and parsers.
+ * Sixteen (SSE2) or thirty two (AVX2) statuses are or-ed together and only
+ * their sign bits are tested, so arrays without failures are checked at
+ * memory speed. AVX2 is picked at runtime unless the build already targets
+ * it, other architectures use a scalar loop.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CDK_ESCAN_X86_
+#endif
+
+static inline size_t cdk_escan_scalar(const int32_t *status, size_t i,
+                                      size_t len) {
+  for (; i < len; i++) {
+    if (status[i] < 0) {
+      break;
+    }
+  }
+
+  return i;
+}
+
+#if defined(CDK_ESCAN_X86_) && defined(__SSE2__)
+static inline size_t cdk_escan_sse2(const int32_t *status, size_t len) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(status + i)));
+    __m128 b =
+        _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(status + i + 4)));
+    __m128 c =
+        _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(status + i + 8)));
+    __m128 d =
+        _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(status + i + 12)));
+
+    if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a, b), _mm_or_ps(c, d)))) {
+      unsigned mask = _mm_movemask_ps(a) | _mm_movemask_ps(b) << 4 |
+                      _mm_movemask_ps(c) << 8 | _mm_movemask_ps(d) << 12;
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return cdk_escan_scalar(status, i, len);
+}
+#endif
+
+#ifdef CDK_ESCAN_X86_
+__attribute__((target("avx2"))) static inline size_t
+cdk_escan_avx2(const int32_t *status, size_t len) {
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256 a = _mm256_castsi256_ps(
+        _mm256_loadu_si256((const __m256i *)(status + i)));
+    __m256 b = _mm256_castsi256_ps(
+        _mm256_loadu_si256((const __m256i *)(status + i + 8)));
+    __m256 c = _mm256_castsi256_ps(
+        _mm256_loadu_si256((const __m256i *)(status + i + 16)));
+    __m256 d = _mm256_castsi256_ps(
+        _mm256_loadu_si256((const __m256i *)(status + i + 24)));
+
+    if (_mm256_movemask_ps(
+            _mm256_or_ps(_mm256_or_ps(a, b), _mm256_or_ps(c, d)))) {
+      uint32_t mask = (uint32_t)_mm256_movemask_ps(a) |
+                      (uint32_t)_mm256_movemask_ps(b) << 8 |
+                      (uint32_t)_mm256_movemask_ps(c) << 16 |
+                      (uint32_t)_mm256_movemask_ps(d) << 24;
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return cdk_escan_scalar(status, i, len);
+}
+#endif
+
+/**
+ * Index of the first negative status, len if there is none.
+ */
+static inline size_t cdk_error_scan_first(const int32_t *status, size_t len) {
+#if defined(CDK_ESCAN_X86_) && defined(__AVX2__)
+  return cdk_escan_avx2(status, len);
+#else
+#ifdef CDK_ESCAN_X86_
+  if (__builtin_cpu_supports("avx2")) {
+    return cdk_escan_avx2(status, len);
+  }
+#endif
+#if defined(CDK_ESCAN_X86_) && defined(__SSE2__)
+  return cdk_escan_sse2(status, len);
+#else
+  return cdk_escan_scalar(status, 0, len);
+#endif
+#endif
+}
+
+/**
+ * Error code of a negative status.
+ */
+static inline uint16_t cdk_escan_code(int32_t status) {
+  return status < -UINT16_MAX ? UINT16_MAX : (uint16_t)-status;
+}
+
+/**
+ * Append every negative status to batch, item index is first_item plus
+ * position in status. Return number of failures found, dropped ones too.
+ */
+static inline size_t cdk_error_scan_batch(struct cdk_EBatch *batch,
+                                          const int32_t *status, size_t len,
+                                          uint32_t first_item,
+                                          CDK_EFRAME_PARAMS) {
+  struct cdk_EFrame frame = CDK_EFRAME_FROM_PARAMS;
+  size_t found = 0;
+
+  for (size_t i = cdk_error_scan_first(status, len); i < len;
+       i += 1 + cdk_error_scan_first(status + i + 1, len - i - 1)) {
+    cdk_ebatch_put(batch, first_item + i, cdk_escan_code(status[i]), NULL,
+                   frame);
+    found++;
+  }
+
+  return found;
+}
+
+/**
+ * Create integer error for the first negative status in err, which is only
+ * evaluated on failure. NULL if every status succeeded.
+ */
+#define cdk_error_check(err, status, len)                                      \
+  ({                                                                           \
+    const int32_t *cdk_status_ = (status);                                     \
+    size_t cdk_len_ = (len);                                                   \
+    size_t cdk_i_ = cdk_error_scan_first(cdk_status_, cdk_len_);               \
+    cdk_i_ == cdk_len_                                                         \
+        ? NULL                                                                 \
+        : cdk_errori((err), cdk_escan_code(cdk_status_[cdk_i_]));              \
+  })
+
+#define cdk_error_check_all(batch, status, len, first_item)                    \
+  (cdk_ecount(), cdk_error_scan_batch((batch), (status), (len), (first_item),  \
+                                      CDK_EFRAME_HERE))
+#endif
+
+/******************************************************************************
+ *                              Serialization                                 *
+ ******************************************************************************/
+/*
+ * Compact binary encoding of struct cdk_Error, all integers little endian:
+ *
+ *   offset size
+ *        0    2  magic "cE"
+ *        2    1  version, CDK_ERROR_ENCODING_VERSION
+ *        3    1  type, cdk_EncodedType
+ *        4    2  code
+ *        6    2  CDK_ERROR_BTRACE_MAX of the encoder
+ *        8    2  CDK_ERROR_FSTR_MAX of the encoder
+ *       10    2  number of frames
+ *       12    2  message length
+ *       14    1  flags, cdk_EncodedFlag
+ *       15    1  reserved
+ *       16       message bytes, no terminator
+ *                frames: u32 site id with cdk_EncodedFlag_SITE_IDS, otherwise
+ *                u32 line, u16 file length, u16 func length, file, func
+ *
+ * Only used frames are encoded. Decoding validates the whole buffer once and
+ * returns views into it, nothing is copied.
+ */
+#define CDK_ERROR_ENCODING_VERSION 1
+#define CDK_ERROR_ENCODING_HEADER 16
+
+enum cdk_EncodedFlag {
+  cdk_EncodedFlag_MSG = 1 << 0,      // Message present
+  cdk_EncodedFlag_SITE_IDS = 1 << 1, // Frames are site ids
+};
+
+/**
+ * View into encoded buffer, not NUL terminated.
+ */
+struct cdk_EView {
+  const char *ptr;
+  size_t len;
+};
+
+/**
+ * Decoded frame.
+ */
+struct cdk_EFrameView {
+  struct cdk_EView file;
+  struct cdk_EView func;
+  uint32_t line;
+  uint32_t site; // Site id if encoded with cdk_EncodedFlag_SITE_IDS
+};
+
+/**
+ * Decoded error.
+ */
+struct cdk_EDecoded {
+  uint8_t version;
+  uint8_t type;
+  uint8_t flags;
+  uint16_t code;
+  uint16_t btrace_max;
+  uint16_t fstr_max;
+  uint16_t eframes_len;
+  struct cdk_EView msg;   // ptr is NULL if there is no message
+  const uint8_t *eframes; // Encoded frames, see cdk_error_decode_frame
+  size_t size;            // Encoded size
+};
+
+static inline uint8_t *cdk_ebin_put16(uint8_t *pos, uint16_t value) {
+  pos[0] = value;
+  pos[1] = value >> 8;
+  return pos + 2;
+}
+
+static inline uint8_t *cdk_ebin_put32(uint8_t *pos, uint32_t value) {
+  pos[0] = value;
+  pos[1] = value >> 8;
+  pos[2] = value >> 16;
+  pos[3] = value >> 24;
+  return pos + 4;
+}
+
+static inline uint16_t cdk_ebin_get16(const uint8_t *pos) {
+  return (uint16_t)(pos[0] | pos[1] << 8);
+}
+
+static inline uint32_t cdk_ebin_get32(const uint8_t *pos) {
+  return (uint32_t)pos[0] | (uint32_t)pos[1] << 8 | (uint32_t)pos[2] << 16 |
+         (uint32_t)pos[3] << 24;
+}
+
+static inline size_t cdk_ebin_strlen(const char *str, size_t max) {
+  const char *end = memchr(str, 0, max);
+  return end ? (size_t)(end - str) : max;
+}
+
+/**
+ * Encode struct cdk_Error into buf. On success sets len to encoded size.
+ */
+static inline int cdk_error_encode(cdk_error_t err, size_t buf_size,
+                                   void *buf, size_t *len) {
+  const char *msg = cdk_error_msg(err);
+  size_t msg_len = msg ? cdk_ebin_strlen(msg, UINT16_MAX) : 0;
+  uint8_t *pos = buf;
+  uint8_t *end = pos + buf_size;
+  uint8_t type = cdk_EncodedType_INT;
+  uint8_t flags = msg ? cdk_EncodedFlag_MSG : 0;
+
+  if (err->type == cdk_ErrorType_STR) {
+    type = cdk_EncodedType_STR;
+  } else if (err->type != cdk_ErrorType_INT) {
+    type = cdk_EncodedType_FSTR;
+  }
+
+#ifdef CDK_ERROR_SITE_IDS
+  flags |= cdk_EncodedFlag_SITE_IDS;
+#endif
+
+  if (buf_size < CDK_ERROR_ENCODING_HEADER + msg_len) {
+    return ENOBUFS;
+  }
+
+  *pos++ = 'c';
+  *pos++ = 'E';
+  *pos++ = CDK_ERROR_ENCODING_VERSION;
+  *pos++ = type;
+  pos = cdk_ebin_put16(pos, err->code);
+  pos = cdk_ebin_put16(pos, CDK_ERROR_BTRACE_MAX);
+  pos = cdk_ebin_put16(pos, CDK_ERROR_FSTR_MAX);
+  pos = cdk_ebin_put16(pos, err->eframes_len);
+  pos = cdk_ebin_put16(pos, msg_len);
+  *pos++ = flags;
+  *pos++ = 0;
+
+  if (msg_len) {
+    memcpy(pos, msg, msg_len);
+    pos += msg_len;
+  }
+
+  // Frames in backtrace order, the dropped count is not encoded.
+  for (size_t i = 0; i < err->eframes_len; i++) {
+    size_t slot = cdk_eframe_slot(err->eframes_len, err->eframes_dropped, i);
+    const struct cdk_EFrame *frame = &err->eframes[slot];
+#ifdef CDK_ERROR_SITE_IDS
+    if ((size_t)(end - pos) < 4) {
+      return ENOBUFS;
+    }
+    pos = cdk_ebin_put32(pos, frame->site);
+#else
+    struct cdk_ESite site = cdk_eframe_site(frame);
+    size_t file_len = cdk_ebin_strlen(site.file, UINT16_MAX);
+    size_t func_len = cdk_ebin_strlen(site.func, UINT16_MAX);
+
+    if ((size_t)(end - pos) < 8 + file_len + func_len) {
+      return ENOBUFS;
+    }
+    pos = cdk_ebin_put32(pos, site.line);
+    pos = cdk_ebin_put16(pos, file_len);
+    pos = cdk_ebin_put16(pos, func_len);
+    memcpy(pos, site.file, file_len);
+    pos += file_len;
+    memcpy(pos, site.func, func_len);
+    pos += func_len;
+#endif
+  }
+
+  *len = pos - (uint8_t *)buf;
+
+  return 0;
+}
+
+/**
+ * Decode frame at pos, return position of the next one. Frames start at
+ * dec->eframes and there are dec->eframes_len of them.
+ */
+static inline const uint8_t *
+cdk_error_decode_frame(const struct cdk_EDecoded *dec, const uint8_t *pos,
+                       struct cdk_EFrameView *frame) {
+  if (dec->flags & cdk_EncodedFlag_SITE_IDS) {
+    *frame = (struct cdk_EFrameView){.site = cdk_ebin_get32(pos)};
+    return pos + 4;
+  }
+
+  frame->site = 0;
+  frame->line = cdk_ebin_get32(pos);
+  frame->file.len = cdk_ebin_get16(pos + 4);
+  frame->func.len = cdk_ebin_get16(pos + 6);
+  frame->file.ptr = (const char *)pos + 8;
+  frame->func.ptr = frame->file.ptr + frame->file.len;
+
+  return pos + 8 + frame->file.len + frame->func.len;
+}
+
+/**
+ * Decode error encoded by cdk_error_encode. Returned views point into buf.
+ */
+static inline int cdk_error_decode(size_t buf_size, const void *buf,
+                                   struct cdk_EDecoded *dec) {
+  const uint8_t *pos = buf;
+  const uint8_t *end = pos + buf_size;
+
+  if (buf_size < CDK_ERROR_ENCODING_HEADER || pos[0] != 'c' ||
+      pos[1] != 'E') {
+    return EBADMSG;
+  }
+  if (pos[2] != CDK_ERROR_ENCODING_VERSION) {
+    return ENOTSUP;
+  }
+
+  dec->version = pos[2];
+  dec->type = pos[3];
+  dec->code = cdk_ebin_get16(pos + 4);
+  dec->btrace_max = cdk_ebin_get16(pos + 6);
+  dec->fstr_max = cdk_ebin_get16(pos + 8);
+  dec->eframes_len = cdk_ebin_get16(pos + 10);
+  dec->msg.len = cdk_ebin_get16(pos + 12);
+  dec->flags = pos[14];
+  pos += CDK_ERROR_ENCODING_HEADER;
+
+  if (dec->type > cdk_EncodedType_FSTR ||
+      (size_t)(end - pos) < dec->msg.len) {
+    return EBADMSG;
+  }
+  dec->msg.ptr =
+      (dec->flags & cdk_EncodedFlag_MSG) ? (const char *)pos : NULL;
+  pos += dec->msg.len;
+
+  dec->eframes = pos;
+  for (size_t i = 0; i < dec->eframes_len; i++) {
+    size_t frame_len = 4;
+    if (!(dec->flags & cdk_EncodedFlag_SITE_IDS)) {
+      if (end - pos < 8) {
+        return EBADMSG;
+      }
+      frame_len = 8 + cdk_ebin_get16(pos + 4) + cdk_ebin_get16(pos + 6);
+    }
+    if ((size_t)(end - pos) < frame_len) {
+      return EBADMSG;
+    }
+    pos += frame_len;
+  }
+
+  dec->size = pos - (const uint8_t *)buf;
+
+  return 0;
+}
+
+/******************************************************************************
+ *                                Error stack                                 *
+ ******************************************************************************/
+#ifdef CDK_ERROR_STACK
+/*
+ * Error stack gives each nesting level its own error slot. Pushing only
+ * remembers the current error pointer and moves creation to the next slot,
+ * so an error being handled is never copied and cannot be clobbered by
+ * cleanup code which fails itself. Popping returns to the previous slot.
+ * Pushes past CDK_ERROR_STACK_MAX are refused and counted in `dropped`, errors
+ * created until the matching pop go to a spill slot instead of the deepest
+ * one, which may still be held by a handler, and are lost on that pop.
+ */
+
+/**
+ * Per-thread stack of error slots on top of a base slot.
+ */
+struct cdk_EStack {
+  struct cdk_Error slots[CDK_ERROR_STACK_MAX]; // Slots of levels 1..MAX
+  cdk_error_t saved[CDK_ERROR_STACK_MAX];      // Error of the level below
+  struct cdk_Error spill;                      // Slot past the last level
+  cdk_error_t spill_saved;                     // Error of the last level
+  size_t depth;                                // Current level, 0 is base
+  size_t overflow;                             // Refused pushes not popped
+  size_t dropped;                              // Refused pushes in total
+};
+
+/**
+ * Slot of the current level, base for level 0.
+ */
+static inline cdk_error_t cdk_error_stack_top(struct cdk_EStack *stack,
+                                              cdk_error_t base) {
+  if (__builtin_expect(!!stack->overflow, 0)) {
+    return &stack->spill;
+  }
+
+  return stack->depth ? &stack->slots[stack->depth - 1] : base;
+}
+
+/**
+ * Save *err and enter next level, *err is cleared. ENOBUFS if the stack is
+ * full, the push is counted as dropped and new errors go to the spill slot
+ * until the matching pop.
+ */
+static inline int cdk_error_stack_push(struct cdk_EStack *stack,
+                                       cdk_error_t *err) {
+  if (stack->depth == CDK_ERROR_STACK_MAX) {
+    if (stack->overflow++ == 0) {
+      stack->spill_saved = *err;
+    }
+    stack->dropped++;
+    *err = NULL;
+    return ENOBUFS;
+  }
+
+  stack->saved[stack->depth++] = *err;
+  *err = NULL;
+
+  return 0;
+}
+
+/**
+ * Leave current level and restore *err saved by the matching push. Errors
+ * created on the level are dropped. ENOBUFS for a refused push, *err is then
+ * restored once the last refused level is left and cleared before. EINVAL
+ * without matching push.
+ */
+static inline int cdk_error_stack_pop(struct cdk_EStack *stack,
+                                      cdk_error_t *err) {
+  if (stack->overflow) {
+    *err = --stack->overflow ? NULL : stack->spill_saved;
+    return ENOBUFS;
+  }
+  if (stack->depth == 0) {
+    return EINVAL;
+  }
+
+  *err = stack->saved[--stack->depth];
+
+  return 0;
+}
+#endif
+
+/******************************************************************************
+ *                                Errno API                                   *
+ ******************************************************************************/
+#ifndef CDK_DISABLE_ERRNO_API
+#ifdef CDK_ERROR_TLS_BLOCK
+/*
+ * Both errno slots in one per-thread variable, one TLS address serves both.
+ */
+struct cdk_ETls {
+  cdk_error_t err;
+  struct cdk_Error slot;
+};
+
+#ifdef CDK_ERROR_TLS_ACCESSOR
+/*
+ * Defined once by the user, returns &cdk_hidden_etls. Like __errno_location it
+ * is `const`, so calls within a function are merged into one. Do not use it
+ * in code which may move to another thread in the middle of a function.
+ */
+__attribute__((const)) struct cdk_ETls *cdk_etls_location(void);
+
+#define cdk_errno (cdk_etls_location()->err)
+#define cdk_hidden_errno (cdk_etls_location()->slot)
+#else
+CDK_ETLS extern struct cdk_ETls cdk_hidden_etls;
+
+#define cdk_errno (cdk_hidden_etls.err)
+#define cdk_hidden_errno (cdk_hidden_etls.slot)
+#endif
+#else
+CDK_ETLS extern cdk_error_t cdk_errno;
+CDK_ETLS extern struct cdk_Error cdk_hidden_errno;
+#endif
+
+#ifdef CDK_ERROR_STACK
+CDK_ETLS extern struct cdk_EStack cdk_hidden_estack;
+
+#define cdk_hidden_errno_top()                                                 \
+  cdk_error_stack_top(&cdk_hidden_estack, &cdk_hidden_errno)
+
+#define cdk_epush() cdk_error_stack_push(&cdk_hidden_estack, &cdk_errno)
+
+#define cdk_epop() cdk_error_stack_pop(&cdk_hidden_estack, &cdk_errno)
+#else
+#define cdk_hidden_errno_top() (&cdk_hidden_errno)
+#endif
+
+#ifdef CDK_ERROR_HISTORY
+CDK_ETLS extern struct cdk_EHistory cdk_hidden_ehistory;
+
+#define cdk_hidden_errno_slot()                                                \
+  cdk_error_history_save(&cdk_hidden_ehistory, cdk_hidden_errno_top())
+
+#define cdk_ehistory_len() cdk_error_history_len(&cdk_hidden_ehistory)
+
+#define cdk_ehistory_get(i) cdk_error_history_get(&cdk_hidden_ehistory, i)
+
+#define cdk_ehistory_clear() cdk_error_history_clear(&cdk_hidden_ehistory)
+
+#define cdk_ehistory_dumps(buf_size, buf)                                      \
+  cdk_error_history_dumps(&cdk_hidden_ehistory, buf_size, buf)
+#else
+#define cdk_hidden_errno_slot() cdk_hidden_errno_top()
+#endif
+
+#define cdk_errnoi(code) cdk_errori(cdk_hidden_errno_slot(), code)
+
+#define cdk_errnos(code, msg) cdk_errors(cdk_hidden_errno_slot(), code, msg)
+
+#if CDK_ERROR_FSTR_ENABLE
+#define cdk_errnof(code, fmt, ...)                                             \
+  cdk_errorf(cdk_hidden_errno_slot(), code, fmt, ##__VA_ARGS__)
+#endif
+
+#ifdef CDK_ERROR_CAUSES
+CDK_ETLS extern struct cdk_ECauses cdk_hidden_ecauses;
+
+/*
+ * Chained errors live in the slab, the error to wrap and dump is the one
+ * cdk_errno points to. The thread's slot is used once there is none.
+ */
+#define cdk_hidden_errno_head()                                                \
+  (cdk_errno && !cdk_errno->shared ? cdk_errno : cdk_hidden_errno_top())
+
+#define cdk_errnoci(code)                                                      \
+  cdk_errorci(&cdk_hidden_ecauses, cdk_errno, code)
+
+#define cdk_errnocs(code, msg)                                                 \
+  cdk_errorcs(&cdk_hidden_ecauses, cdk_errno, code, msg)
+
+#if CDK_ERROR_FSTR_ENABLE
+#define cdk_errnocf(code, fmt, ...)                                            \
+  cdk_errorcf(&cdk_hidden_ecauses, cdk_errno, code, fmt,        \
+              ##__VA_ARGS__)
+#endif
+#else
+#define cdk_hidden_errno_head() cdk_hidden_errno_top()
+#endif
+
+/**
+ * Error dumps read, a static error in cdk_errno is read in place.
+ */
+#define cdk_hidden_errno_cur()                                                 \
+  (cdk_errno && cdk_errno->shared ? cdk_errno : cdk_hidden_errno_head())
+
+/**
+ * Error wraps extend, a static error in cdk_errno is promoted to the thread's
+ * slot first.
+ */
+#define cdk_hidden_errno_own()                                                 \
+  (cdk_errno && cdk_errno->shared                                              \
+       ? (cdk_errno = cdk_error_promote(cdk_errno, cdk_hidden_errno_slot()))   \
+       : cdk_hidden_errno_head())
+
+#if defined(CDK_ERROR_OUTLINE) && CDK_ERROR_BTRACE_ENABLE
+/**
+ * Out of line cdk_ewrap. Takes thread state as arguments, so it is safe to
+ * emit in translation units which do not define it.
+ */
+static CDK_ECOLD cdk_error_t cdk_error_wrap_own(cdk_error_t *errp,
+                                                struct cdk_Error *top,
+                                                struct cdk_EHistory *history,
+                                                CDK_EFRAME_PARAMS) {
+  struct cdk_EFrame frame = CDK_EFRAME_FROM_PARAMS;
+
+  if (*errp && (*errp)->shared) {
+    if (history) {
+      cdk_error_history_save(history, top);
+    }
+    *errp = cdk_error_promote(*errp, top);
+  }
+  cdk_error_add_frame(top, &frame);
+
+  return top;
+}
+
+#ifdef CDK_ERROR_HISTORY
+#define cdk_hidden_ehistory_ptr() (&cdk_hidden_ehistory)
+#else
+#define cdk_hidden_ehistory_ptr() NULL
+#endif
+
+#define cdk_ewrap()                                                            \
+  cdk_escope_noted_(cdk_error_wrap_own(&cdk_errno, cdk_hidden_errno_head(),    \
+                                       cdk_hidden_ehistory_ptr(),              \
+                                       CDK_EFRAME_HERE))
+
+#define cdk_ereturn(ret) (cdk_ewrap(), (ret))
+#else
+#define cdk_ewrap() cdk_error_wrap(cdk_hidden_errno_own())
+
+#define cdk_ereturn(ret) cdk_error_return((ret), cdk_hidden_errno_own())
+#endif
+
+/**
+ * Mark thread's error as handled. It stays readable by dumps, but scopes left
+ * after this point do not add their frames to it and chained constructors do
+ * not take it as a cause. Dumps read the thread's slot then, chained errors
+ * are not reachable from it.
+ */
+#define cdk_ehandled() (cdk_escope_forget(cdk_escope), (void)(cdk_errno = NULL))
+
+#if CDK_ERROR_BTRACE_ENABLE
+#ifdef CDK_ERROR_SITE_IDS
+#define CDK_ESCOPE_SITE_ATTR_                                                  \
+  __attribute__((section("cdk_esites"), used, aligned(sizeof(void *))))
+#else
+#define CDK_ESCOPE_SITE_ATTR_
+#endif
+
+/**
+ * Frame of a static call site descriptor.
+ */
+static inline struct cdk_EFrame cdk_eframe_at(const struct cdk_ESite *site) {
+#if defined(CDK_ERROR_SITE_IDS)
+  return (struct cdk_EFrame){
+      .site = (cdk_esite_id_t)(site - __start_cdk_esites)};
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE
+  return (struct cdk_EFrame){.line = site->line};
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC
+  return (struct cdk_EFrame){.func = site->func, .line = site->line};
+#else
+  return (struct cdk_EFrame){
+      .file = site->file, .func = site->func, .line = site->line};
+#endif
+}
+
+/**
+ * Wrap thread's error with the frame of a scope left while it was set, unless
+ * the scope's own activation added its newest frame by creating or wrapping
+ * it. Static errors are promoted either way. Takes thread state as arguments,
+ * like cdk_error_wrap_own.
+ */
+static CDK_ECOLD void cdk_error_scope_wrap(cdk_error_t *errp,
+                                          struct cdk_Error *top,
+                                          struct cdk_EHistory *history,
+                                          const struct cdk_EScope *scope) {
+  struct cdk_EFrame frame = cdk_eframe_at(scope->site);
+  bool noted = scope->err == *errp && (*errp)->eframes_len == scope->len &&
+               (*errp)->eframes_dropped == scope->dropped;
+
+  if ((*errp)->shared) {
+    if (history) {
+      cdk_error_history_save(history, top);
+    }
+    *errp = cdk_error_promote(*errp, top);
+  }
+  if (!noted) {
+    cdk_error_add_frame(top, &frame);
+  }
+}
+
+#ifdef CDK_ERROR_HISTORY
+#define cdk_hidden_escope_history() (&cdk_hidden_ehistory)
+#else
+#define cdk_hidden_escope_history() NULL
+#endif
+
+/**
+ * Cleanup of CDK_FRAME, on success it costs one load of cdk_errno.
+ */
+static inline void cdk_hidden_escope_leave(const struct cdk_EScope *scope) {
+  if (__builtin_expect(!!cdk_errno, 0)) {
+    cdk_error_scope_wrap(&cdk_errno, cdk_hidden_errno_head(),
+                         cdk_hidden_escope_history(), scope);
+  }
+}
+
+/**
+ * Scope guard, put first in a function body. When the scope is left with
+ * cdk_errno set, its frame is added to the error as if cdk_ewrap was called,
+ * so error returns do not need cdk_ereturn. Call cdk_ehandled once an error
+ * is dealt with, otherwise the scope reports a stale error. The frame points
+ * at the CDK_FRAME line. Creation and wrap macros used in the same activation
+ * note it in cdk_escope, the frame is left out when the newest one is theirs.
+ */
+#define CDK_FRAME()                                                            \
+  static const struct cdk_ESite cdk_escope_site CDK_ESCOPE_SITE_ATTR_ = {      \
+      .file = __FILE_NAME__, .func = __func__, .line = __LINE__};              \
+  __attribute__((cleanup(cdk_hidden_escope_leave))) struct cdk_EScope          \
+      cdk_escope_frame = {.site = &cdk_escope_site};                           \
+  _Pragma("GCC diagnostic push")                                               \
+  _Pragma("GCC diagnostic ignored \"-Wshadow\"")                               \
+  struct cdk_EScope *const cdk_escope __attribute__((unused)) =                \
+      &cdk_escope_frame;                                                       \
+  _Pragma("GCC diagnostic pop")
+#else
+#define CDK_FRAME()
+#endif
+
+#define cdk_edumps(buf_size, buf)                                              \
+  cdk_error_dumps(cdk_hidden_errno_cur(), buf_size, buf)
+
+#ifdef CDK_EPOSIX_
+#define cdk_edumpfd(fd) cdk_error_dumpfd(cdk_hidden_errno_cur(), fd)
+#endif
+
+#define cdk_ebatch_get(batch, entry)                                           \
+  cdk_error_batch_get((batch), (entry), cdk_hidden_errno_slot())
+
+#ifdef CDK_ERROR_SCAN
+#define cdk_echeck(status, len)                                                \
+  cdk_error_check(cdk_hidden_errno_slot(), status, len)
+#endif
+
+#define cdk_eencode(buf_size, buf, len)                                        \
+  cdk_error_encode(cdk_hidden_errno_cur(), buf_size, buf, len)
 
 #endif
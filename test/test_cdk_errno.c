@@ -4,6 +4,12 @@
 #include "cdk_error.h"
 #include "unity.h"
 
+#ifdef CDK_ERROR_DUMP_ERRNO_NAME
+#define NAME(name) "Error name: " name "\n"
+#else
+#define NAME(name) ""
+#endif
+
 void test_integer_error_creation(void) {
   struct cdk_Error *err, base;
   err = cdk_error_int(&base, EINVAL, __FILE_NAME__, __func__, __LINE__);
@@ -35,7 +41,7 @@ void test_string_error_creation(void) {
 }
 
 void test_string_fmt_error_creation(void) {
-#ifndef CDK_ERROR_OPTIMIZE
+#if CDK_ERROR_FSTR_ENABLE
   struct cdk_Error *err, base;
   err = cdk_error_fstr(&base, EINVAL, __FILE_NAME__, __func__, __LINE__,
                        "Invalid user input: %d", EINVAL);
@@ -66,10 +72,10 @@ void test_error_dump_to_str(void) {
   TEST_ASSERT_EQUAL_STRING(
       "====== ERROR DUMP ======\n"
       "Error code: 100\n"
-      "Error desc: Network is down\n"
+      "Error desc: Network is down\n" NAME("ENETDOWN")
       "------------------------\n"
       " Backtrace:\n"
-      "   [00] test_cdk_errno.c:test_error_dump_to_str:61\n",
+      "   [00] test_cdk_errno.c:test_error_dump_to_str:67\n",
       buf);
 
   err = cdk_errors(&base, 200, "Format error");
@@ -79,11 +85,79 @@ void test_error_dump_to_str(void) {
   TEST_ASSERT_EQUAL_STRING(
       "====== ERROR DUMP ======\n"
       "Error code: 200\n"
-      "Error desc: Unknown error 200\n"
+      "Error desc: Unknown error 200\n" // No name line for unknown codes
       "------------------------\n"
       " Error msg: Format error\n"
       "------------------------\n"
       " Backtrace:\n"
-      "   [00] test_cdk_errno.c:test_error_dump_to_str:75\n",
+      "   [00] test_cdk_errno.c:test_error_dump_to_str:81\n",
       buf);
 }
+
+void test_error_dump_too_small_buffer(void) {
+  struct cdk_Error *err, base;
+  err = cdk_errors(&base, 200, "Format error");
+  TEST_ASSERT_NOT_NULL(err);
+
+  char buf[1024];
+  TEST_ASSERT_EQUAL(0, cdk_error_dumps(err, sizeof(buf), buf));
+  size_t len = strlen(buf);
+
+  char small[1024];
+  for (size_t size = 1; size <= len; size++) {
+    TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_dumps(err, size, small));
+    TEST_ASSERT_EQUAL(size - 1, strlen(small));
+    TEST_ASSERT_EQUAL_MEMORY(buf, small, size - 1);
+  }
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_dumps(err, 0, NULL));
+}
+
+void test_wrap_follows_btrace_enable(void) {
+  struct cdk_Error *err, base;
+  err = cdk_errori(&base, EIO);
+  cdk_error_wrap(err);
+
+#if CDK_ERROR_BTRACE_ENABLE
+  TEST_ASSERT_EQUAL(2, err->eframes_len);
+#else
+  TEST_ASSERT_EQUAL(1, err->eframes_len);
+#endif
+}
+
+void test_errno_desc(void) {
+  TEST_ASSERT_EQUAL_STRING("Success", cdk_error_desc(0));
+  TEST_ASSERT_EQUAL_STRING("Operation not permitted", cdk_error_desc(EPERM));
+  TEST_ASSERT_EQUAL_STRING("No such file or directory",
+                           cdk_error_desc(ENOENT));
+  TEST_ASSERT_EQUAL_STRING("Input/output error", cdk_error_desc(EIO));
+  TEST_ASSERT_EQUAL_STRING("Cannot allocate memory", cdk_error_desc(ENOMEM));
+  TEST_ASSERT_EQUAL_STRING("Invalid argument", cdk_error_desc(EINVAL));
+  TEST_ASSERT_EQUAL_STRING("Network is down", cdk_error_desc(ENETDOWN));
+  TEST_ASSERT_NULL(cdk_error_desc(UINT16_MAX));
+}
+
+// Table copies glibc wording, other C libraries describe codes differently.
+void test_errno_desc_matches_strerror(void) {
+#ifdef __GLIBC__
+  char expected[64];
+
+  for (uint16_t code = 0; code < 256; code++) {
+    const char *desc = cdk_error_desc(code);
+    if (!desc) {
+      snprintf(expected, sizeof(expected), "Unknown error %u", code);
+      TEST_ASSERT_EQUAL_STRING(expected, strerror(code));
+      continue;
+    }
+    TEST_ASSERT_EQUAL_STRING(strerror(code), desc);
+  }
+#endif
+}
+
+void test_errno_name(void) {
+  TEST_ASSERT_EQUAL_STRING("EINVAL", cdk_error_name(EINVAL));
+  TEST_ASSERT_EQUAL_STRING("ENETDOWN", cdk_error_name(ENETDOWN));
+  TEST_ASSERT_EQUAL_STRING("EAGAIN", cdk_error_name(EWOULDBLOCK));
+  TEST_ASSERT_NULL(cdk_error_name(0));
+  TEST_ASSERT_NULL(cdk_error_name(200));
+  TEST_ASSERT_NULL(cdk_error_name(UINT16_MAX));
+}
@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+static struct cdk_EBatch batch;
+static _Alignas(8) char storage[64 * CDK_EBATCH_ENTRY_SIZE];
+
+void setUp(void) {
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_init(&batch, storage, sizeof(storage)));
+}
+
+void tearDown(void) {}
+
+static void validate(uint32_t count) {
+  for (uint32_t item = 0; item < count; item++) {
+    if (item % 10 == 3) {
+      cdk_error_batch_add(&batch, item, EINVAL, "Invalid record");
+    } else if (item % 10 == 7) {
+      cdk_error_batch_add(&batch, item, ERANGE, NULL);
+    }
+  }
+}
+
+void test_init_rejects_tiny_storage(void) {
+  struct cdk_EBatch tiny;
+
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_batch_init(&tiny, storage,
+                                                  7 * CDK_EBATCH_ENTRY_SIZE));
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_init(&tiny, storage,
+                                            8 * CDK_EBATCH_ENTRY_SIZE));
+  TEST_ASSERT_EQUAL(8, tiny.cap);
+}
+
+void test_unaligned_storage(void) {
+  struct cdk_EBatch unaligned;
+
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_init(&unaligned, storage + 1,
+                                            sizeof(storage) - 1));
+  TEST_ASSERT_EQUAL(56, unaligned.cap);
+  TEST_ASSERT_EQUAL(0, (uintptr_t)unaligned.msgs % sizeof(void *));
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_add(&unaligned, 1, EIO, "Unaligned"));
+  TEST_ASSERT_EQUAL(1, unaligned.items[0]);
+}
+
+void test_collects_every_failure(void) {
+  validate(40);
+
+  TEST_ASSERT_EQUAL(8, batch.len);
+  TEST_ASSERT_EQUAL(0, batch.dropped);
+  TEST_ASSERT_EQUAL(3, batch.items[0]);
+  TEST_ASSERT_EQUAL(EINVAL, batch.codes[0]);
+  TEST_ASSERT_EQUAL_STRING("Invalid record", batch.msgs[0]);
+  TEST_ASSERT_EQUAL(7, batch.items[1]);
+  TEST_ASSERT_EQUAL(ERANGE, batch.codes[1]);
+  TEST_ASSERT_NULL(batch.msgs[1]);
+
+  TEST_ASSERT_EQUAL(4, cdk_error_batch_count(&batch, EINVAL));
+  TEST_ASSERT_EQUAL(4, cdk_error_batch_count(&batch, ERANGE));
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_count(&batch, EIO));
+}
+
+void test_first_failure(void) {
+  size_t entry;
+
+  TEST_ASSERT_FALSE(cdk_error_batch_first(&batch, &entry));
+
+  cdk_error_batch_add(&batch, 50, EIO, NULL);
+  cdk_error_batch_add(&batch, 20, EINVAL, NULL);
+  cdk_error_batch_add(&batch, 30, EIO, NULL);
+
+  TEST_ASSERT_TRUE(cdk_error_batch_first(&batch, &entry));
+  TEST_ASSERT_EQUAL(1, entry);
+}
+
+void test_full_batch_counts_dropped(void) {
+  validate(1000);
+
+  TEST_ASSERT_EQUAL(batch.cap, batch.len);
+  TEST_ASSERT_EQUAL(200 - batch.cap, batch.dropped);
+}
+
+void test_grow_keeps_entries(void) {
+  static _Alignas(8) char bigger[256 * CDK_EBATCH_ENTRY_SIZE];
+
+  validate(1000);
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_batch_grow(&batch, bigger,
+                                                  8 * CDK_EBATCH_ENTRY_SIZE));
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_grow(&batch, bigger, sizeof(bigger)));
+  memset(storage, 0, sizeof(storage));
+
+  TEST_ASSERT_EQUAL(64, batch.len);
+  TEST_ASSERT_EQUAL(256, batch.cap);
+  TEST_ASSERT_EQUAL(317, batch.items[63]);
+  TEST_ASSERT_EQUAL(ERANGE, batch.codes[63]);
+  TEST_ASSERT_EQUAL_STRING("Invalid record", batch.msgs[62]);
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_add(&batch, 1000, EIO, NULL));
+}
+
+void test_entry_as_error(void) {
+  char buf[1024];
+
+  validate(10);
+  cdk_errno = cdk_ebatch_get(&batch, 0);
+
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Invalid record", cdk_errno->msg);
+  cdk_ewrap();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 22\n"
+      "Error desc: Invalid argument\n"
+      "------------------------\n"
+      " Error msg: Invalid record\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_batch.c:validate:22\n"
+      "   [01] test_cdk_errno_batch.c:test_entry_as_error:112\n",
+      buf);
+
+  cdk_errno = cdk_ebatch_get(&batch, 1);
+  TEST_ASSERT_EQUAL(cdk_ErrorType_INT, cdk_errno->type);
+  TEST_ASSERT_EQUAL(ERANGE, cdk_errno->code);
+}
+
+void test_batch_dump_to_str(void) {
+  char buf[1024];
+
+  validate(20);
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_dumps(&batch, sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== BATCH DUMP ======\n"
+      "Failures: 4\n"
+      "------------------------\n"
+      "   [3] 22 test_cdk_errno_batch.c:validate:22 Invalid record\n"
+      "   [7] 34 test_cdk_errno_batch.c:validate:24\n"
+      "   [13] 22 test_cdk_errno_batch.c:validate:22 Invalid record\n"
+      "   [17] 34 test_cdk_errno_batch.c:validate:24\n",
+      buf);
+
+  validate(1000);
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_batch_dumps(&batch, sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, "Failures: 64 (+140 dropped)\n"));
+}
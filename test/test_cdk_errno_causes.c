@@ -0,0 +1,207 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+_Thread_local struct cdk_ECauses cdk_hidden_ecauses = {0};
+
+void setUp(void) {
+  cdk_hidden_errno = (struct cdk_Error){0};
+  cdk_hidden_ecauses = (struct cdk_ECauses){0};
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static int read_config(void) {
+  cdk_errno = cdk_errnos(ENOENT, "No config file");
+  return cdk_ereturn(-1);
+}
+
+static int load_config(void) {
+  if (read_config()) {
+    cdk_errno = cdk_errnocs(EINVAL, "Config not loaded");
+    return cdk_ereturn(-1);
+  }
+  return 0;
+}
+
+void test_plain_error_has_no_cause(void) {
+  read_config();
+  TEST_ASSERT_NULL(cdk_error_cause(cdk_errno));
+}
+
+void test_first_error_has_no_cause(void) {
+  cdk_errno = cdk_errnoci(EINVAL);
+  TEST_ASSERT_NULL(cdk_error_cause(cdk_errno));
+}
+
+void test_handled_error_is_not_a_cause(void) {
+  read_config();
+  cdk_ehandled();
+  cdk_errno = cdk_errnoci(EINVAL);
+  TEST_ASSERT_NULL(cdk_error_cause(cdk_errno));
+}
+
+void test_chained_error_keeps_cause(void) {
+  TEST_ASSERT_EQUAL(-1, load_config());
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Config not loaded", cdk_errno->msg);
+
+  const struct cdk_Error *cause = cdk_error_cause(cdk_errno);
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_ecauses.errors[0], cause); // Root copied
+  TEST_ASSERT_EQUAL(ENOENT, cause->code);
+  TEST_ASSERT_EQUAL_STRING("No config file", cause->msg);
+  TEST_ASSERT_EQUAL(2, cause->eframes_len);
+  TEST_ASSERT_EQUAL_STRING("read_config", cause->eframes[1].func);
+  TEST_ASSERT_NULL(cdk_ecause_get(&cause->cause));
+}
+
+void test_static_error_is_a_cause(void) {
+  read_config(); // Stale error left in the thread's slot
+  cdk_errno = cdk_error_statics(EAGAIN, "Queue full");
+  cdk_errno = cdk_errnoci(EINVAL);
+
+  const struct cdk_Error *cause = cdk_error_cause(cdk_errno);
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_ecauses.errors[0], cause);
+  TEST_ASSERT_EQUAL(EAGAIN, cause->code);
+  TEST_ASSERT_EQUAL_STRING("Queue full", cause->msg);
+  TEST_ASSERT_FALSE(cause->shared);
+}
+
+void test_new_error_drops_link(void) {
+  load_config();
+  cdk_errno = cdk_errnoi(ENOMEM);
+  TEST_ASSERT_NULL(cdk_error_cause(cdk_errno));
+}
+
+void test_unrelated_error_keeps_cause(void) {
+  load_config();
+  cdk_error_t chained = cdk_errno;
+
+  cdk_errno = cdk_errnoi(ENOMEM); // Overwrites the thread's slot
+
+  const struct cdk_Error *cause = cdk_error_cause(chained);
+  TEST_ASSERT_NOT_NULL(cause);
+  TEST_ASSERT_EQUAL(ENOENT, cause->code);
+  TEST_ASSERT_EQUAL_STRING("No config file", cause->msg);
+}
+
+void test_linked_cause_is_not_copied_again(void) {
+  load_config();
+  const struct cdk_Error *cause = cdk_errno;
+
+  cdk_errno = cdk_errnoci(EIO);
+
+  TEST_ASSERT_EQUAL_PTR(cause, cdk_error_cause(cdk_errno));
+}
+
+void test_formatted_cause_is_kept(void) {
+  cdk_errno = cdk_errnof(ENOENT, "No file %s, tried %d search paths",
+                         "a_file_name_long_enough_to_be_truncated", 3);
+  cdk_errno = cdk_errnocf(EINVAL, "Config %d not loaded", 7);
+
+  const struct cdk_Error *cause = cdk_error_cause(cdk_errno);
+  TEST_ASSERT_NOT_NULL(cause);
+  TEST_ASSERT_EQUAL_STRING(
+      "No file a_file_name_long_enough_to_be_truncated, tried 3 search paths",
+      cdk_error_msg((cdk_error_t)cause));
+  TEST_ASSERT_EQUAL_STRING("Config 7 not loaded", cdk_error_msg(cdk_errno));
+}
+
+void test_chain_of_causes(void) {
+  load_config();
+  cdk_errno = cdk_errnoci(EIO);
+
+  const struct cdk_Error *cause = cdk_error_cause(cdk_errno);
+  TEST_ASSERT_NOT_NULL(cause);
+  TEST_ASSERT_EQUAL(EINVAL, cause->code);
+
+  cause = cdk_ecause_get(&cause->cause);
+  TEST_ASSERT_NOT_NULL(cause);
+  TEST_ASSERT_EQUAL(ENOENT, cause->code);
+  TEST_ASSERT_NULL(cdk_ecause_get(&cause->cause));
+}
+
+void test_overwritten_cause_is_dropped(void) {
+  read_config();
+  for (int i = 0; i < CDK_ERROR_CAUSES_MAX + 1; i++) {
+    cdk_errno = cdk_errnoci(EIO);
+  }
+
+  // Head and CDK_ERROR_CAUSES_MAX - 1 causes fit the slab.
+  const struct cdk_Error *cause = cdk_error_cause(cdk_errno);
+  for (int i = 1; i < CDK_ERROR_CAUSES_MAX - 1; i++) {
+    TEST_ASSERT_NOT_NULL(cause);
+    TEST_ASSERT_EQUAL(EIO, cause->code);
+    cause = cdk_ecause_get(&cause->cause);
+  }
+  TEST_ASSERT_NOT_NULL(cause);
+  TEST_ASSERT_EQUAL(EIO, cause->code);
+  TEST_ASSERT_NOT_NULL(cause->cause.ptr);
+  TEST_ASSERT_NULL(cdk_ecause_get(&cause->cause));
+}
+
+void test_dump_renders_chain(void) {
+  char buf[2048];
+
+  load_config();
+  cdk_ewrap();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 22\n"
+      "Error desc: Invalid argument\n"
+      "------------------------\n"
+      " Error msg: Config not loaded\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_causes.c:load_config:26\n"
+      "   [01] test_cdk_errno_causes.c:load_config:27\n"
+      "   [02] test_cdk_errno_causes.c:test_dump_renders_chain:152\n"
+      "====== CAUSED BY =======\n"
+      "Error code: 2\n"
+      "Error desc: No such file or directory\n"
+      "------------------------\n"
+      " Error msg: No config file\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_causes.c:read_config:20\n"
+      "   [01] test_cdk_errno_causes.c:read_config:21\n",
+      buf);
+}
+
+void test_dump_marks_dropped_cause(void) {
+  char buf[4096];
+
+  read_config();
+  for (int i = 0; i < CDK_ERROR_CAUSES_MAX + 1; i++) {
+    cdk_errno = cdk_errnoci(EIO);
+  }
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(
+      strstr(buf, " Cause dropped, raise CDK_ERROR_CAUSES_MAX\n"));
+  TEST_ASSERT_NULL(strstr(buf, "No config file"));
+}
+
+void test_dump_after_unrelated_error(void) {
+  char buf[2048];
+
+  load_config();
+  cdk_error_t chained = cdk_errno;
+  cdk_ewrap();
+
+  // Failing cleanup on the unwind path.
+  cdk_errno = cdk_errnos(EBADF, "Close failed");
+  cdk_errno = chained;
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, " Error msg: No config file\n"));
+  TEST_ASSERT_NULL(strstr(buf, "Cause dropped"));
+  TEST_ASSERT_NULL(strstr(buf, "Close failed"));
+}
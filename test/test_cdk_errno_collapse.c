@@ -0,0 +1,99 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+#if defined(CDK_ERROR_SITE_IDS) || CDK_ERROR_FRAME_INFO == CDK_EFRAME_FULL
+#define FRAME(func, line) "test_cdk_errno_collapse.c:" #func ":" #line
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC
+#define FRAME(func, line) "?:" #func ":" #line
+#else
+#define FRAME(func, line) "?:?:" #line
+#endif
+
+void setUp(void) { cdk_errno = NULL; }
+
+void tearDown(void) {}
+
+static int descend(int depth) {
+  if (depth == 0) {
+    cdk_errno = cdk_errnoi(EIO);
+    return -1;
+  }
+  return descend(depth - 1) ? cdk_ereturn(-1) : 0;
+}
+
+static int parse(int depth) { return descend(depth) ? cdk_ereturn(-1) : 0; }
+
+void test_recursion_takes_one_frame(void) {
+  parse(37);
+
+  TEST_ASSERT_EQUAL(3, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(0, cdk_errno->eframes[0].repeat);
+  TEST_ASSERT_EQUAL(36, cdk_errno->eframes[1].repeat);
+  TEST_ASSERT_EQUAL(0, cdk_errno->eframes[2].repeat);
+}
+
+void test_same_function_other_line_is_kept(void) {
+  descend(0);
+  cdk_ewrap();
+  cdk_ewrap();
+
+  TEST_ASSERT_EQUAL(3, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(0, cdk_errno->eframes[1].repeat);
+}
+
+void test_dump_repeated_frame(void) {
+  char buf[1024];
+
+  parse(37);
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING("====== ERROR DUMP ======\n"
+                           "Error code: 5\n"
+                           "Error desc: Input/output error\n"
+                           "------------------------\n"
+                           " Backtrace:\n"
+                           "   [00] " FRAME(descend, 25) "\n"
+                           "   [01] " FRAME(descend, 28) " (x37)\n"
+                           "   [02] " FRAME(parse, 31) "\n",
+                           buf);
+}
+
+void test_wrap_in_loop(void) {
+  descend(0);
+  for (int i = 0; i < 2 * CDK_ERROR_BTRACE_MAX; i++) {
+    cdk_ewrap();
+  }
+
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(0, cdk_errno->eframes_dropped);
+  TEST_ASSERT_EQUAL(2 * CDK_ERROR_BTRACE_MAX - 1,
+                    cdk_errno->eframes[1].repeat);
+}
+
+void test_repeat_after_overflow(void) {
+#if !defined(CDK_ERROR_SITE_IDS) && CDK_ERROR_FRAME_INFO == CDK_EFRAME_FULL
+  struct cdk_Error base;
+  cdk_error_t err = cdk_errori(&base, EIO);
+  struct cdk_EFrame frame = {.file = "f.c", .func = "f"};
+
+  for (int line = 1; line < CDK_ERROR_BTRACE_MAX + 3; line++) {
+    frame.line = line;
+    cdk_error_add_frame(err, &frame);
+  }
+  // Newest frame sits in the middle of the ring now.
+  cdk_error_add_frame(err, &frame);
+
+  size_t last = cdk_eframe_slot(err->eframes_len, err->eframes_dropped,
+                                err->eframes_len - 1);
+  TEST_ASSERT_EQUAL(3, err->eframes_dropped);
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX + 2, err->eframes[last].line);
+  TEST_ASSERT_EQUAL(1, err->eframes[last].repeat);
+#endif
+}
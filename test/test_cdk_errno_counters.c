@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+void setUp(void) { cdk_error_counters_reset(); }
+
+void tearDown(void) {}
+
+static cdk_error_t rare_func(void) {
+  cdk_errno = cdk_errnoi(EINVAL);
+  return cdk_errno;
+}
+
+static cdk_error_t frequent_func(void) {
+  cdk_errno = cdk_errnos(ENOMEM, "Frequent error");
+  return cdk_errno;
+}
+
+static cdk_error_t catching_func(void) {
+  cdk_errno = frequent_func();
+  CDK_TRY(cdk_errno);
+
+  return 0;
+
+error_out:
+  return cdk_errno;
+}
+
+void test_counter_takes_cache_line(void) {
+  TEST_ASSERT_EQUAL(64, sizeof(struct cdk_ECounter));
+}
+
+void test_top_sites(void) {
+  struct cdk_ECount top[8];
+
+  rare_func();
+  for (int i = 0; i < 5; i++) {
+    frequent_func();
+  }
+  for (int i = 0; i < 3; i++) {
+    catching_func();
+  }
+
+  size_t len = cdk_error_counters_top(top, 8);
+  TEST_ASSERT_EQUAL(3, len);
+
+  TEST_ASSERT_EQUAL(8, top[0].count);
+  TEST_ASSERT_EQUAL_STRING("frequent_func", top[0].site.func);
+  TEST_ASSERT_EQUAL(20, top[0].site.line);
+
+  TEST_ASSERT_EQUAL(3, top[1].count);
+  TEST_ASSERT_EQUAL_STRING("catching_func", top[1].site.func);
+  TEST_ASSERT_EQUAL(26, top[1].site.line);
+
+  TEST_ASSERT_EQUAL(1, top[2].count);
+  TEST_ASSERT_EQUAL_STRING("rare_func", top[2].site.func);
+
+  len = cdk_error_counters_top(top, 1);
+  TEST_ASSERT_EQUAL(1, len);
+  TEST_ASSERT_EQUAL(8, top[0].count);
+
+  TEST_ASSERT_EQUAL(0, cdk_error_counters_top(top, 0));
+}
+
+void test_reset(void) {
+  struct cdk_ECount top[1];
+
+  rare_func();
+  cdk_error_counters_reset();
+
+  TEST_ASSERT_EQUAL(0, cdk_error_counters_top(top, 1));
+}
+
+void test_counters_dump_to_str(void) {
+  struct cdk_ECount top[2];
+  char buf[512];
+
+  rare_func();
+  frequent_func();
+  frequent_func();
+
+  size_t len = cdk_error_counters_top(top, 2);
+  TEST_ASSERT_EQUAL(0, cdk_error_counters_dumps(top, len, sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "===== ERROR COUNTERS =====\n"
+      "   [00] 2 test_cdk_errno_counters.c:frequent_func:20\n"
+      "   [01] 1 test_cdk_errno_counters.c:rare_func:15\n",
+      buf);
+
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_counters_dumps(top, len, 32, buf));
+}
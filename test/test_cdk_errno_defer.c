@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <stdio.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+#define ASSERT_RENDERS_LIKE_SNPRINTF(fmt, ...)                                 \
+  do {                                                                         \
+    char expected[1024];                                                       \
+    snprintf(expected, sizeof(expected), fmt, ##__VA_ARGS__);                  \
+    expected[CDK_ERROR_FSTR_MAX - 1] = 0;                                      \
+    cdk_errno = cdk_errnof(EINVAL, fmt, ##__VA_ARGS__);                        \
+    TEST_ASSERT_EQUAL_STRING(expected, cdk_error_msg(cdk_errno));              \
+  } while (0)
+
+void test_formatting_is_deferred(void) {
+  cdk_errno = cdk_errnof(EINVAL, "Invalid user input: %d", EINVAL);
+  TEST_ASSERT_EQUAL(cdk_ErrorType_FSTR_LAZY, cdk_errno->type);
+
+  TEST_ASSERT_EQUAL_STRING("Invalid user input: 22", cdk_error_msg(cdk_errno));
+  TEST_ASSERT_EQUAL(cdk_ErrorType_FSTR, cdk_errno->type);
+  TEST_ASSERT_EQUAL_STRING("Invalid user input: 22", cdk_errno->msg);
+}
+
+void test_string_arguments_are_copied(void) {
+  char path[] = "/opt/super_secret_file.txt";
+
+  cdk_errno = cdk_errnof(EINPROGRESS, "Cannot interrupt: %s", path);
+  path[1] = 'X';
+
+  TEST_ASSERT_EQUAL_STRING("Cannot interrupt: /opt/super_secret_file.txt",
+                           cdk_error_msg(cdk_errno));
+}
+
+void test_conversions_render_like_snprintf(void) {
+  char not_terminated[4] = {'a', 'b', 'c', 'd'};
+  long double ld = 2.5L;
+
+  ASSERT_RENDERS_LIKE_SNPRINTF("no conversions");
+  ASSERT_RENDERS_LIKE_SNPRINTF("%d %i %u %x %X %o %c", -1, 2, 3u, 255, 255, 8,
+                               'z');
+  ASSERT_RENDERS_LIKE_SNPRINTF("%hhd %hd %ld %lld %jd %zu %td", 1, 2, -3L,
+                               -4LL, (intmax_t)5, (size_t)6, (ptrdiff_t)-7);
+  ASSERT_RENDERS_LIKE_SNPRINTF("%f %.2e %g %Lf %a", 1.5, 2.25, 3.0, ld, 1.0);
+  ASSERT_RENDERS_LIKE_SNPRINTF("%-8s|%8s|%.2s|%.3s|", "ab", "cd", "efgh",
+                               not_terminated);
+  ASSERT_RENDERS_LIKE_SNPRINTF("%*d|%-*d|%.*f|%*.*s|", 5, 1, 5, 2, 3, 1.0, 6,
+                               2, "abcd");
+  ASSERT_RENDERS_LIKE_SNPRINTF("%p %s 100%%", (void *)&ld, (char *)NULL);
+}
+
+void test_long_message_is_truncated(void) {
+  char arg[CDK_ERROR_FSTR_MAX / 2];
+  memset(arg, 'x', sizeof(arg) - 1);
+  arg[sizeof(arg) - 1] = 0;
+
+  ASSERT_RENDERS_LIKE_SNPRINTF("%200d|%100d|", 1, 2);
+
+  // Arguments do not fit into _msg_buf, formatted on creation
+  cdk_errno = cdk_errnof(EINVAL, "%s%s%s", arg, arg, arg);
+  TEST_ASSERT_EQUAL(cdk_ErrorType_FSTR, cdk_errno->type);
+  ASSERT_RENDERS_LIKE_SNPRINTF("%s%s%s", arg, arg, arg);
+}
+
+void test_error_dump_to_str(void) {
+  char buf[1024];
+
+  cdk_errno = cdk_errnof(200, "Format error %d", 7);
+  cdk_edumps(sizeof(buf), buf);
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 200\n"
+      "Error desc: Unknown error 200\n"
+      "------------------------\n"
+      " Error msg: Format error 7\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_defer.c:test_error_dump_to_str:71\n",
+      buf);
+}
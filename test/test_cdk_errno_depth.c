@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+_Thread_local size_t cdk_hidden_edepth = 0;
+
+void setUp(void) { cdk_error_depth_set(CDK_ERROR_BTRACE_MAX); }
+
+void tearDown(void) { unsetenv(CDK_ERROR_DEPTH_ENV); }
+
+static size_t fail_and_wrap(int wraps) {
+  cdk_errno = cdk_errnoi(EIO);
+  for (int i = 0; i < wraps; i++) {
+    cdk_ewrap();
+  }
+  return cdk_errno->eframes_len;
+}
+
+static int thread_main(void *arg) {
+  (void)arg;
+  return (int)fail_and_wrap(2 * CDK_ERROR_BTRACE_MAX);
+}
+
+// Depth seen by a new thread, which reads the environment on first wrap.
+static int depth_in_new_thread(const char *env) {
+  thrd_t thread;
+  int depth;
+
+  if (env) {
+    setenv(CDK_ERROR_DEPTH_ENV, env, 1);
+  }
+  if (thrd_create(&thread, thread_main, NULL) != thrd_success ||
+      thrd_join(thread, &depth) != thrd_success) {
+    return -1;
+  }
+
+  return depth;
+}
+
+void test_default_depth(void) {
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, depth_in_new_thread(NULL));
+}
+
+void test_depth_from_env(void) {
+  TEST_ASSERT_EQUAL(3, depth_in_new_thread("3"));
+  TEST_ASSERT_EQUAL(1, depth_in_new_thread("1"));
+}
+
+void test_invalid_env_uses_max(void) {
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, depth_in_new_thread("0"));
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, depth_in_new_thread("3x"));
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, depth_in_new_thread("1000"));
+}
+
+void test_env_is_read_once(void) {
+  setenv(CDK_ERROR_DEPTH_ENV, "2", 1);
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, cdk_error_depth_get());
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX,
+                    fail_and_wrap(2 * CDK_ERROR_BTRACE_MAX));
+}
+
+void test_set_depth(void) {
+  TEST_ASSERT_EQUAL(0, cdk_error_depth_set(2));
+  TEST_ASSERT_EQUAL(2, cdk_error_depth_get());
+  TEST_ASSERT_EQUAL(2, fail_and_wrap(5));
+
+  TEST_ASSERT_EQUAL(EINVAL, cdk_error_depth_set(0));
+  TEST_ASSERT_EQUAL(EINVAL, cdk_error_depth_set(CDK_ERROR_BTRACE_MAX + 1));
+  TEST_ASSERT_EQUAL(2, cdk_error_depth_get());
+}
+
+void test_raise_depth_while_wrapping(void) {
+  cdk_error_depth_set(2);
+  TEST_ASSERT_EQUAL(2, fail_and_wrap(1));
+
+  cdk_error_depth_set(4);
+  cdk_ewrap();
+  cdk_ewrap();
+  TEST_ASSERT_EQUAL(4, cdk_errno->eframes_len);
+}
+
+void test_raise_depth_after_overflow(void) {
+  cdk_error_depth_set(1);
+  TEST_ASSERT_EQUAL(1, fail_and_wrap(3));
+
+  // Error keeps its length, the next one gets the new depth.
+  cdk_error_depth_set(4);
+  cdk_ewrap();
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(4, cdk_errno->eframes_dropped);
+  TEST_ASSERT_EQUAL(4, fail_and_wrap(5));
+}
@@ -0,0 +1,260 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+struct cdk_EFlight cdk_hidden_eflight = {0};
+
+#define FLIGHT_PATH "test_cdk_errno_flight.bin"
+#define THREADS 4
+#define THREAD_ERRORS 1000
+
+static struct {
+  struct cdk_EFlightHeader hdr;
+  struct cdk_EFlightRecord records[4096];
+  struct cdk_EFlightSite sites[CDK_ERROR_FLIGHT_SITES];
+} flight;
+
+void setUp(void) { memset(&flight, 0, sizeof(flight)); }
+
+void tearDown(void) {
+  cdk_error_flight_close();
+  unlink(FLIGHT_PATH);
+}
+
+static void load_flight(size_t records_len) {
+  size_t size = records_len * sizeof(flight.records[0]);
+  int fd = open(FLIGHT_PATH, O_RDONLY);
+
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_EQUAL(sizeof(flight.hdr),
+                    read(fd, &flight.hdr, sizeof(flight.hdr)));
+  TEST_ASSERT_EQUAL(size, read(fd, flight.records, size));
+  TEST_ASSERT_EQUAL(sizeof(flight.sites),
+                    read(fd, flight.sites, sizeof(flight.sites)));
+  TEST_ASSERT_EQUAL(0, read(fd, flight.records, 1));
+  close(fd);
+
+  TEST_ASSERT_EQUAL_MEMORY("cdkeflt", flight.hdr.magic, 8);
+  TEST_ASSERT_EQUAL(CDK_ERROR_FLIGHT_VERSION, flight.hdr.version);
+  TEST_ASSERT_EQUAL(sizeof(struct cdk_EFlightRecord), flight.hdr.record_size);
+  TEST_ASSERT_EQUAL(records_len, flight.hdr.records_len);
+  TEST_ASSERT_EQUAL(CDK_ERROR_FLIGHT_SITES, flight.hdr.sites_len);
+  TEST_ASSERT_EQUAL(sizeof(struct cdk_EFlightSite), flight.hdr.site_size);
+}
+
+// Site entry of a record, NULL if it holds another site.
+static const struct cdk_EFlightSite *
+flight_site(const struct cdk_EFlightRecord *rec) {
+  const struct cdk_EFlightSite *entry =
+      &flight.sites[rec->site & (CDK_ERROR_FLIGHT_SITES - 1)];
+
+  return rec->site && entry->hash == rec->site ? entry : NULL;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec now;
+
+  clock_gettime(CDK_EFLIGHT_CLOCK, &now);
+  return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static int failing_func(uint16_t code) {
+  cdk_errno = cdk_errnos(code, "Failing func");
+  return cdk_ereturn(-1);
+}
+
+void test_open_rejects_bad_length(void) {
+  TEST_ASSERT_EQUAL(EINVAL, cdk_error_flight_open(FLIGHT_PATH, 0));
+  TEST_ASSERT_EQUAL(EINVAL, cdk_error_flight_open(FLIGHT_PATH, 6));
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 8));
+  TEST_ASSERT_EQUAL(EBUSY, cdk_error_flight_open(FLIGHT_PATH, 8));
+}
+
+void test_closed_recorder_is_noop(void) {
+  TEST_ASSERT_EQUAL(-1, failing_func(EINVAL));
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+}
+
+void test_records_created_errors(void) {
+  const struct cdk_EFlightSite *site;
+  uint64_t start = now_ns();
+
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 8));
+
+  failing_func(EINVAL);
+  cdk_ewrap();
+  cdk_errno = cdk_errnoi(ENOMEM);
+  cdk_errno = cdk_errnof(ENOENT, "No file %s", "a_file");
+  load_flight(8);
+
+  TEST_ASSERT_EQUAL(3, flight.hdr.head);
+  TEST_ASSERT_EQUAL(1, flight.records[0].seq);
+  TEST_ASSERT_EQUAL(cdk_EncodedType_STR, flight.records[0].type);
+  TEST_ASSERT_EQUAL(EINVAL, flight.records[0].code);
+  TEST_ASSERT_EQUAL((uintptr_t)thrd_current(), flight.records[0].thread);
+  TEST_ASSERT_TRUE(flight.records[0].time >= start);
+  TEST_ASSERT_TRUE(flight.records[0].time <= now_ns());
+  site = flight_site(&flight.records[0]);
+  TEST_ASSERT_NOT_NULL(site);
+  TEST_ASSERT_EQUAL(72, site->line);
+  TEST_ASSERT_EQUAL(strlen("test_cdk_errno_flight.c"), site->file_len);
+  TEST_ASSERT_EQUAL_MEMORY("test_cdk_errno_flight.c", site->file,
+                           site->file_len);
+  TEST_ASSERT_EQUAL(strlen("failing_func"), site->func_len);
+  TEST_ASSERT_EQUAL_MEMORY("failing_func", site->func, site->func_len);
+
+  TEST_ASSERT_EQUAL(2, flight.records[1].seq);
+  TEST_ASSERT_EQUAL(cdk_EncodedType_INT, flight.records[1].type);
+  TEST_ASSERT_EQUAL(ENOMEM, flight.records[1].code);
+  TEST_ASSERT_TRUE(flight.records[1].time >= flight.records[0].time);
+  TEST_ASSERT_EQUAL(96, flight_site(&flight.records[1])->line);
+
+  TEST_ASSERT_EQUAL(3, flight.records[2].seq);
+  TEST_ASSERT_EQUAL(cdk_EncodedType_FSTR, flight.records[2].type);
+  TEST_ASSERT_EQUAL(ENOENT, flight.records[2].code);
+  TEST_ASSERT_NOT_EQUAL(flight.records[1].site, flight.records[2].site);
+
+  TEST_ASSERT_EQUAL(0, flight.records[3].seq);
+}
+
+void test_site_is_written_once(void) {
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 8));
+
+  for (int i = 0; i < 3; i++) {
+    failing_func(EIO);
+  }
+  load_flight(8);
+
+  TEST_ASSERT_EQUAL(flight.records[0].site, flight.records[2].site);
+  TEST_ASSERT_NOT_NULL(flight_site(&flight.records[2]));
+  for (size_t i = 0; i < CDK_ERROR_FLIGHT_SITES; i++) {
+    TEST_ASSERT_TRUE(&flight.sites[i] == flight_site(&flight.records[0]) ||
+                     flight.sites[i].hash == CDK_EFLIGHT_SITE_EMPTY);
+  }
+}
+
+void test_taken_site_entry_is_not_resolved(void) {
+  struct cdk_EFlightSite *entry;
+  uint32_t hash;
+
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 8));
+
+  failing_func(EIO);
+  hash = cdk_hidden_eflight.records[0].site;
+  entry = &cdk_hidden_eflight.sites[hash & (CDK_ERROR_FLIGHT_SITES - 1)];
+  // Another site with the same entry, or its writer, got there first.
+  atomic_store(&entry->hash, CDK_EFLIGHT_SITE_BUSY);
+  failing_func(EIO);
+  load_flight(8);
+
+  TEST_ASSERT_EQUAL(hash, flight.records[1].site);
+  TEST_ASSERT_NULL(flight_site(&flight.records[1]));
+}
+
+void test_ring_keeps_most_recent_errors(void) {
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 4));
+
+  for (uint16_t code = 1; code <= 10; code++) {
+    cdk_errno = cdk_errnoi(code);
+  }
+  load_flight(4);
+
+  TEST_ASSERT_EQUAL(10, flight.hdr.head);
+  for (size_t i = 0; i < 4; i++) {
+    uint64_t seq = flight.records[i].seq;
+    TEST_ASSERT_TRUE(seq > 6 && seq <= 10);
+    TEST_ASSERT_EQUAL(i, (seq - 1) % 4);
+    TEST_ASSERT_EQUAL(seq, flight.records[i].code);
+  }
+}
+
+void test_records_survive_kill(void) {
+  const struct cdk_EFlightSite *site;
+  int status;
+  pid_t pid = fork();
+
+  TEST_ASSERT_TRUE(pid >= 0);
+  if (pid == 0) {
+    if (cdk_error_flight_open(FLIGHT_PATH, 8) == 0) {
+      failing_func(EPIPE);
+    }
+    raise(SIGKILL);
+    _exit(1);
+  }
+
+  TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+  TEST_ASSERT_TRUE(WIFSIGNALED(status));
+  load_flight(8);
+
+  TEST_ASSERT_EQUAL(1, flight.records[0].seq);
+  TEST_ASSERT_EQUAL(EPIPE, flight.records[0].code);
+  site = flight_site(&flight.records[0]);
+  TEST_ASSERT_NOT_NULL(site);
+  TEST_ASSERT_EQUAL_MEMORY("failing_func", site->func, strlen("failing_func"));
+}
+
+static int thread_main(void *arg) {
+  uint16_t code = (uintptr_t)arg;
+
+  for (int i = 0; i < THREAD_ERRORS; i++) {
+    failing_func(code);
+  }
+
+  return 0;
+}
+
+void test_threads_claim_distinct_slots(void) {
+  size_t per_thread[THREADS + 1] = {0};
+  thrd_t threads[THREADS];
+
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 4096));
+
+  for (uintptr_t i = 0; i < THREADS; i++) {
+    TEST_ASSERT_EQUAL(thrd_success,
+                      thrd_create(&threads[i], thread_main, (void *)(i + 1)));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    thrd_join(threads[i], NULL);
+  }
+  load_flight(4096);
+
+  TEST_ASSERT_EQUAL(THREADS * THREAD_ERRORS, flight.hdr.head);
+  for (size_t i = 0; i < THREADS * THREAD_ERRORS; i++) {
+    TEST_ASSERT_EQUAL(i + 1, flight.records[i].seq);
+    TEST_ASSERT_TRUE(flight.records[i].code >= 1 &&
+                     flight.records[i].code <= THREADS);
+    per_thread[flight.records[i].code]++;
+  }
+  for (int i = 1; i <= THREADS; i++) {
+    TEST_ASSERT_EQUAL(THREAD_ERRORS, per_thread[i]);
+  }
+}
+
+void test_records_static_error_site(void) {
+  TEST_ASSERT_EQUAL(0, cdk_error_flight_open(FLIGHT_PATH, 8));
+
+  cdk_errno = cdk_error_statici(ENOMEM);
+  load_flight(8);
+
+  TEST_ASSERT_EQUAL(ENOMEM, flight.records[0].code);
+#ifdef CDK_ERROR_SITE_IDS
+  // Static errors start without frames here, no site is recorded.
+  TEST_ASSERT_EQUAL(0, flight.records[0].site);
+#else
+  const struct cdk_EFlightSite *site = flight_site(&flight.records[0]);
+  TEST_ASSERT_NOT_NULL(site);
+  TEST_ASSERT_EQUAL(__LINE__ - 10, site->line);
+  TEST_ASSERT_EQUAL(CDK_EFLIGHT_FUNC_MAX, site->func_len); // Truncated
+  TEST_ASSERT_EQUAL_MEMORY(__func__, site->func, CDK_EFLIGHT_FUNC_MAX);
+#endif
+}
@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+struct cdk_ESymCache cdk_hidden_esymcache = {0};
+
+void setUp(void) { cdk_errno = NULL; }
+
+void tearDown(void) {}
+
+// Exported and never inlined, so dladdr finds them and each has own frame.
+__attribute__((noinline)) int fp_inner(void) {
+  cdk_errno = cdk_errnoi(EIO);
+  return -1;
+}
+
+__attribute__((noinline)) int fp_outer(void) {
+  int ret = fp_inner();
+  __asm__ volatile("" ::: "memory"); // Keep the call out of tail position
+  return ret;
+}
+
+__attribute__((noinline)) int fp_recurse(int depth) {
+  int ret = depth ? fp_recurse(depth - 1) : fp_inner();
+  __asm__ volatile("" ::: "memory");
+  return ret;
+}
+
+// Position of name among resolved return addresses, -1 if missing.
+static int addr_index(const char *name) {
+  for (size_t i = 0; i < cdk_errno->eaddrs_len; i++) {
+    struct cdk_ESymbol symbol = cdk_error_fp_resolve(cdk_errno->eaddrs[i]);
+    if (symbol.name && strcmp(symbol.name, name) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void test_walk_records_callers(void) {
+  fp_outer();
+
+  TEST_ASSERT_GREATER_THAN(1, cdk_errno->eaddrs_len);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, addr_index("fp_inner"));
+  TEST_ASSERT_GREATER_THAN(addr_index("fp_inner"), addr_index("fp_outer"));
+  TEST_ASSERT_GREATER_THAN(addr_index("fp_outer"),
+                           addr_index("test_walk_records_callers"));
+}
+
+void test_walk_is_bounded(void) {
+  fp_recurse(2 * CDK_ERROR_FP_MAX);
+
+  TEST_ASSERT_EQUAL(CDK_ERROR_FP_MAX, cdk_errno->eaddrs_len);
+}
+
+void test_resolve_is_cached(void) {
+  fp_outer();
+
+  struct cdk_ESymbol first = cdk_error_fp_resolve(cdk_errno->eaddrs[0]);
+  struct cdk_ESymbol second = cdk_error_fp_resolve(cdk_errno->eaddrs[0]);
+  TEST_ASSERT_EQUAL_PTR(cdk_errno->eaddrs[0], first.addr);
+  TEST_ASSERT_EQUAL_PTR(first.name, second.name);
+  TEST_ASSERT_EQUAL_PTR(first.module, second.module);
+  TEST_ASSERT_EQUAL(first.offset, second.offset);
+  TEST_ASSERT_NOT_NULL(first.module);
+}
+
+void test_dump_resolves_addresses(void) {
+  char buf[4096];
+
+  fp_outer();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, "------------------------\n"
+                                   " Call stack:\n"));
+  TEST_ASSERT_NOT_NULL(strstr(buf, "] fp_outer+0x"));
+}
+
+void test_dumpfd_writes_raw_addresses(void) {
+  char buf[4096] = {0};
+  int fds[2];
+
+  fp_outer();
+
+  TEST_ASSERT_EQUAL(0, pipe(fds));
+  TEST_ASSERT_EQUAL(0, cdk_edumpfd(fds[1]));
+  close(fds[1]);
+  TEST_ASSERT_GREATER_THAN(0, read(fds[0], buf, sizeof(buf) - 1));
+  close(fds[0]);
+
+  TEST_ASSERT_NOT_NULL(strstr(buf, " Call stack:\n   [00] 0x"));
+  TEST_ASSERT_NULL(strstr(buf, "fp_outer+"));
+}
+
+void test_static_error_has_no_addresses(void) {
+  cdk_error_t err = cdk_error_statici(ENOMEM);
+
+  TEST_ASSERT_EQUAL(0, err->eaddrs_len);
+}
+
+void test_batch_entry_has_no_addresses(void) {
+  static _Alignas(8) char storage[8 * CDK_EBATCH_ENTRY_SIZE];
+  struct cdk_EBatch batch;
+
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_init(&batch, storage, sizeof(storage)));
+  cdk_error_batch_add(&batch, 3, EINVAL, NULL);
+  cdk_errno = cdk_ebatch_get(&batch, 0);
+
+  TEST_ASSERT_EQUAL(0, cdk_errno->eaddrs_len);
+}
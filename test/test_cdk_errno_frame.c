@@ -0,0 +1,139 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+// Lines are kept in every frame info mode
+#define LINE_AT(i) cdk_error_site(cdk_errno, &cdk_errno->eframes[i]).line
+
+void setUp(void) { cdk_errno = NULL; }
+
+void tearDown(void) {}
+
+static int open_device(void) {
+  CDK_FRAME();
+  cdk_errno = cdk_errnoi(ENODEV);
+  return -1;
+}
+
+static int start(void) {
+  CDK_FRAME();
+  if (open_device()) {
+    return -1;
+  }
+  return 0;
+}
+
+static int start_wrapped(void) {
+  CDK_FRAME();
+  if (open_device()) {
+    return cdk_ereturn(-1);
+  }
+  return 0;
+}
+
+static int start_with_fallback(void) {
+  CDK_FRAME();
+  if (start()) {
+    cdk_ehandled(); // Fallback works without the device
+  }
+  return 0;
+}
+
+static int succeed(void) {
+  CDK_FRAME();
+  return 0;
+}
+
+static int backpressure(void) {
+  CDK_FRAME();
+  cdk_errno = cdk_error_statics(EAGAIN, "Queue full");
+  return -1;
+}
+
+static int walk(int depth) {
+  CDK_FRAME();
+  if (!depth) {
+    cdk_errno = cdk_errnoi(ENOENT);
+    return -1;
+  }
+  return walk(depth - 1);
+}
+
+void test_success_adds_nothing(void) {
+  TEST_ASSERT_EQUAL(0, succeed());
+  TEST_ASSERT_NULL(cdk_errno);
+}
+
+void test_error_adds_scope_frames(void) {
+  TEST_ASSERT_EQUAL(-1, start());
+
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(19, LINE_AT(0));
+  TEST_ASSERT_EQUAL(24, LINE_AT(1));
+}
+
+void test_wrapped_scope_adds_no_frame(void) {
+  TEST_ASSERT_EQUAL(-1, start_wrapped());
+
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(19, LINE_AT(0));
+  TEST_ASSERT_EQUAL(34, LINE_AT(1));
+}
+
+void test_handled_error_is_left_alone(void) {
+  TEST_ASSERT_EQUAL(0, start_with_fallback());
+
+  TEST_ASSERT_NULL(cdk_errno);
+  TEST_ASSERT_EQUAL(2, cdk_hidden_errno.eframes_len);
+}
+
+void test_static_error_is_promoted(void) {
+  TEST_ASSERT_EQUAL(-1, backpressure());
+
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_errno, cdk_errno);
+  TEST_ASSERT_EQUAL_STRING("Queue full", cdk_errno->msg);
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_len);
+#ifdef CDK_ERROR_SITE_IDS
+  TEST_ASSERT_EQUAL(53, LINE_AT(0)); // Scope frame, static errors have none
+#else
+  TEST_ASSERT_EQUAL(54, LINE_AT(0));
+#endif
+}
+
+void test_recursion_adds_frame_per_call(void) {
+  TEST_ASSERT_EQUAL(-1, walk(3));
+
+#ifdef CDK_ERROR_COLLAPSE
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes[1].repeat);
+#else
+  TEST_ASSERT_EQUAL(4, cdk_errno->eframes_len);
+  for (size_t i = 1; i < 4; i++) {
+    TEST_ASSERT_EQUAL(59, LINE_AT(i));
+  }
+#endif
+  TEST_ASSERT_EQUAL(61, LINE_AT(0));
+}
+
+void test_dump_scope_frames(void) {
+#if CDK_ERROR_FRAME_INFO == CDK_EFRAME_FULL
+  char buf[1024];
+
+  start();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING("====== ERROR DUMP ======\n"
+                           "Error code: 19\n"
+                           "Error desc: No such device\n"
+                           "------------------------\n"
+                           " Backtrace:\n"
+                           "   [00] test_cdk_errno_frame.c:open_device:19\n"
+                           "   [01] test_cdk_errno_frame.c:start:24\n",
+                           buf);
+#endif
+}
@@ -0,0 +1,151 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+_Thread_local struct cdk_EHistory cdk_hidden_ehistory = {0};
+
+void setUp(void) {
+  cdk_hidden_errno = (struct cdk_Error){0};
+  cdk_ehistory_clear();
+}
+
+void tearDown(void) {}
+
+static int failing_func(uint16_t code) {
+  cdk_errno = cdk_errnos(code, "Failing func");
+  return cdk_ereturn(-1);
+}
+
+// Message of a record, deferred ones are rendered on load.
+static const char *record_msg(size_t i) {
+  static struct cdk_Error err;
+
+  cdk_error_history_load(&err, cdk_ehistory_get(i));
+  return cdk_error_msg(&err);
+}
+
+void test_first_error_is_not_saved(void) {
+  cdk_errno = cdk_errnoi(EINVAL);
+  TEST_ASSERT_EQUAL(0, cdk_ehistory_len());
+  TEST_ASSERT_NULL(cdk_ehistory_get(0));
+}
+
+void test_replaced_error_is_saved_with_frames(void) {
+  failing_func(EINVAL);
+  cdk_ewrap();
+
+  cdk_errno = cdk_errnoi(ENOMEM);
+  TEST_ASSERT_EQUAL(1, cdk_ehistory_len());
+
+  const struct cdk_ERecord *record = cdk_ehistory_get(0);
+  TEST_ASSERT_NOT_NULL(record);
+  TEST_ASSERT_EQUAL(EINVAL, record->code);
+  TEST_ASSERT_EQUAL_STRING("Failing func", record->msg);
+  TEST_ASSERT_EQUAL(3, record->eframes_len);
+  TEST_ASSERT_EQUAL_STRING("failing_func",
+                           cdk_eframe_site(&record->eframes[0]).func);
+  TEST_ASSERT_EQUAL_STRING("test_replaced_error_is_saved_with_frames",
+                           cdk_eframe_site(&record->eframes[2]).func);
+
+  TEST_ASSERT_EQUAL(ENOMEM, cdk_errno->code);
+}
+
+void test_ring_keeps_most_recent_errors(void) {
+  for (uint16_t code = 1; code <= CDK_ERROR_HISTORY_MAX + 3; code++) {
+    cdk_errno = cdk_errnoi(code);
+  }
+
+  TEST_ASSERT_EQUAL(CDK_ERROR_HISTORY_MAX, cdk_ehistory_len());
+  for (size_t i = 0; i < cdk_ehistory_len(); i++) {
+    TEST_ASSERT_EQUAL(CDK_ERROR_HISTORY_MAX + 2 - i, cdk_ehistory_get(i)->code);
+  }
+  TEST_ASSERT_NULL(cdk_ehistory_get(CDK_ERROR_HISTORY_MAX));
+}
+
+void test_formatted_message_is_copied(void) {
+  cdk_errno = cdk_errnof(EINVAL, "Formatted %d", 1);
+  cdk_errno = cdk_errnof(ENOMEM, "Formatted %d", 2);
+  cdk_errno = cdk_errnoi(ENOMEM);
+
+  TEST_ASSERT_EQUAL(EINVAL, cdk_ehistory_get(1)->code);
+  TEST_ASSERT_EQUAL_STRING("Formatted 1", record_msg(1));
+  TEST_ASSERT_EQUAL_STRING("Formatted 2", record_msg(0));
+}
+
+void test_deferred_message_is_rendered_on_dump(void) {
+#ifdef CDK_ERROR_DEFER_FSTR
+  char buf[2048];
+
+  cdk_errno = cdk_errnof(EINVAL, "Formatted %d %s", 1, "arg");
+  cdk_errno = cdk_errnoi(ENOMEM);
+
+  // Saving neither renders the error nor the record.
+  TEST_ASSERT_EQUAL(cdk_ErrorType_FSTR_LAZY, cdk_ehistory_get(0)->type);
+  TEST_ASSERT_EQUAL_STRING("Formatted %d %s", cdk_ehistory_get(0)->msg);
+
+  TEST_ASSERT_EQUAL(0, cdk_ehistory_dumps(sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, " Error msg: Formatted 1 arg\n"));
+  TEST_ASSERT_EQUAL(cdk_ErrorType_FSTR_LAZY, cdk_ehistory_get(0)->type);
+#endif
+}
+
+void test_deferred_arguments_too_long_are_rendered(void) {
+#ifdef CDK_ERROR_DEFER_FSTR
+  char arg[CDK_ERROR_HISTORY_MSG_MAX + 1];
+
+  memset(arg, 'x', sizeof(arg) - 1);
+  arg[sizeof(arg) - 1] = 0;
+
+  cdk_errno = cdk_errnof(EINVAL, "%s", arg);
+  cdk_errno = cdk_errnoi(ENOMEM);
+
+  arg[CDK_ERROR_HISTORY_MSG_MAX - 1] = 0;
+  TEST_ASSERT_EQUAL(cdk_ErrorType_FSTR, cdk_ehistory_get(0)->type);
+  TEST_ASSERT_EQUAL_STRING(arg, cdk_ehistory_get(0)->msg);
+#endif
+}
+
+void test_long_formatted_message_is_truncated(void) {
+  char expected[CDK_ERROR_HISTORY_MSG_MAX];
+
+  memset(expected, 'x', sizeof(expected) - 1);
+  expected[sizeof(expected) - 1] = 0;
+
+  cdk_errno = cdk_errnof(EINVAL, "%s%s", expected, "yyyy");
+  cdk_errno = cdk_errnoi(ENOMEM);
+
+  TEST_ASSERT_EQUAL_STRING(expected, record_msg(0));
+}
+
+void test_history_dump_to_str(void) {
+  char buf[2048];
+
+  cdk_errno = cdk_errnoi(100);
+  failing_func(200);
+  cdk_errno = cdk_errnoi(EINVAL);
+
+  TEST_ASSERT_EQUAL(0, cdk_ehistory_dumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 100\n"
+      "Error desc: Network is down\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_history.c:test_history_dump_to_str:127\n"
+      "====== ERROR DUMP ======\n"
+      "Error code: 200\n"
+      "Error desc: Unknown error 200\n"
+      "------------------------\n"
+      " Error msg: Failing func\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_history.c:failing_func:19\n"
+      "   [01] test_cdk_errno_history.c:failing_func:20\n",
+      buf);
+
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_ehistory_dumps(64, buf));
+}
@@ -0,0 +1,100 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+void setUp(void) { cdk_errno = NULL; }
+
+void tearDown(void) {}
+
+static int l1(void) {
+  cdk_errno = cdk_errnoi(EIO);
+  return -1;
+}
+static int l2(void) { return l1() ? cdk_ereturn(-1) : 0; }
+static int l3(void) { return l2() ? cdk_ereturn(-1) : 0; }
+static int l4(void) { return l3() ? cdk_ereturn(-1) : 0; }
+static int l5(void) { return l4() ? cdk_ereturn(-1) : 0; }
+static int l6(void) { return l5() ? cdk_ereturn(-1) : 0; }
+static int l7(void) { return l6() ? cdk_ereturn(-1) : 0; }
+
+static const char *func_at(size_t i) {
+  return cdk_errno->eframes[cdk_eframe_slot(cdk_errno->eframes_len,
+                                            cdk_errno->eframes_dropped, i)]
+      .func;
+}
+
+void test_no_overflow(void) {
+  l4();
+
+  TEST_ASSERT_EQUAL(4, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(0, cdk_errno->eframes_dropped);
+  TEST_ASSERT_EQUAL_STRING("l4", func_at(3));
+}
+
+void test_overflow_keeps_head_and_tail(void) {
+  l7();
+
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(7 - CDK_ERROR_BTRACE_MAX, cdk_errno->eframes_dropped);
+  TEST_ASSERT_EQUAL_STRING("l1", func_at(0));
+  TEST_ASSERT_EQUAL_STRING("l2", func_at(1));
+#if CDK_ERROR_BTRACE_HEAD < CDK_ERROR_BTRACE_MAX
+  TEST_ASSERT_EQUAL_STRING("l6", func_at(2));
+  TEST_ASSERT_EQUAL_STRING("l7", func_at(3));
+#else
+  TEST_ASSERT_EQUAL_STRING("l4", func_at(3));
+#endif
+}
+
+void test_dump_reports_dropped(void) {
+  char buf[1024];
+
+  l7();
+  cdk_ewrap();
+
+  const char *expected = "====== ERROR DUMP ======\n"
+                         "Error code: 5\n"
+                         "Error desc: Input/output error\n"
+                         "------------------------\n"
+                         " Backtrace:\n"
+                         "   [00] test_cdk_errno_overflow.c:l1:15\n"
+                         "   [01] test_cdk_errno_overflow.c:l2:18\n"
+#if CDK_ERROR_BTRACE_HEAD < CDK_ERROR_BTRACE_MAX
+                         "   ... 4 frames dropped ...\n"
+                         "   [06] test_cdk_errno_overflow.c:l7:23\n"
+                         "   [07] test_cdk_errno_overflow.c:"
+                         "test_dump_reports_dropped:58\n";
+#else
+                         "   [02] test_cdk_errno_overflow.c:l3:19\n"
+                         "   [03] test_cdk_errno_overflow.c:l4:20\n"
+                         "   ... 4 frames dropped ...\n";
+#endif
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_encode_follows_backtrace_order(void) {
+  struct cdk_EDecoded dec;
+  struct cdk_EFrameView frame;
+  uint8_t buf[512];
+  size_t len;
+
+  l7();
+
+  TEST_ASSERT_EQUAL(0, cdk_eencode(sizeof(buf), buf, &len));
+  TEST_ASSERT_EQUAL(0, cdk_error_decode(len, buf, &dec));
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, dec.eframes_len);
+
+  const uint8_t *pos = dec.eframes;
+  for (size_t i = 0; i < dec.eframes_len; i++) {
+    pos = cdk_error_decode_frame(&dec, pos, &frame);
+    TEST_ASSERT_EQUAL(strlen(func_at(i)), frame.func.len);
+    TEST_ASSERT_EQUAL_MEMORY(func_at(i), frame.func.ptr, frame.func.len);
+  }
+}
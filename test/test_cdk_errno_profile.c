@@ -0,0 +1,86 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+#if CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE
+#define FRAME(func, line) "?:?:" #line "\n"
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC
+#define FRAME(func, line) "?:" #func ":" #line "\n"
+#else
+#define FRAME(func, line) "test_cdk_errno_profile.c:" #func ":" #line "\n"
+#endif
+
+void setUp(void) {
+  cdk_hidden_errno = (struct cdk_Error){0};
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static int failing(void) {
+  cdk_errno = cdk_errnos(EINVAL, "Invalid user input");
+  return cdk_ereturn(-1);
+}
+
+void test_wrap_follows_btrace_enable(void) {
+  failing();
+  cdk_ewrap();
+
+#if CDK_ERROR_BTRACE_ENABLE
+  TEST_ASSERT_EQUAL(3, cdk_errno->eframes_len);
+#else
+  TEST_ASSERT_EQUAL(1, cdk_hidden_errno.eframes_len);
+  TEST_ASSERT_EQUAL(1, CDK_ERROR_BTRACE_MAX);
+#endif
+}
+
+void test_dump_follows_frame_info(void) {
+  char buf[1024];
+
+  failing();
+  cdk_ewrap();
+
+  const char *expected = "====== ERROR DUMP ======\n"
+                         "Error code: 22\n"
+                         "Error desc: Invalid argument\n"
+                         "------------------------\n"
+                         " Error msg: Invalid user input\n"
+                         "------------------------\n"
+                         " Backtrace:\n"
+                         "   [00] " FRAME(failing, 26)
+#if CDK_ERROR_BTRACE_ENABLE
+                         "   [01] " FRAME(failing, 27)
+                         "   [02] " FRAME(test_dump_follows_frame_info, 46)
+#endif
+      ;
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_frame_size_follows_frame_info(void) {
+#if defined(CDK_ERROR_SITE_IDS)
+  TEST_ASSERT_EQUAL(sizeof(cdk_esite_id_t), sizeof(struct cdk_EFrame));
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_LINE
+  TEST_ASSERT_EQUAL(sizeof(uint32_t), sizeof(struct cdk_EFrame));
+#elif CDK_ERROR_FRAME_INFO == CDK_EFRAME_FUNC
+  TEST_ASSERT_EQUAL(2 * sizeof(void *), sizeof(struct cdk_EFrame));
+#else
+  TEST_ASSERT_EQUAL(3 * sizeof(void *), sizeof(struct cdk_EFrame));
+#endif
+}
+
+void test_formatted_messages_follow_fstr_enable(void) {
+#if CDK_ERROR_FSTR_ENABLE
+  cdk_errno = cdk_errnof(EINVAL, "Invalid user input: %d", 7);
+  TEST_ASSERT_EQUAL_STRING("Invalid user input: 7", cdk_error_msg(cdk_errno));
+  TEST_ASSERT_EQUAL(CDK_ERROR_FSTR_MAX, sizeof(cdk_hidden_errno._msg_buf));
+#elif defined(cdk_errnof)
+  TEST_FAIL_MESSAGE("cdk_errnof defined with CDK_ERROR_FSTR_ENABLE=0");
+#endif
+}
@@ -0,0 +1,134 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+_Thread_local struct cdk_ESampler cdk_hidden_esampler = {0};
+
+void setUp(void) {
+  cdk_hidden_esampler = (struct cdk_ESampler){0};
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static int failing(void) {
+  cdk_errno = cdk_errnos(EIO, "Device failed");
+  return -1;
+}
+
+static int forward(void) {
+  if (failing()) {
+    return cdk_ereturn(-1);
+  }
+  return 0;
+}
+
+static int traced_of(int errors) {
+  int traced = 0;
+
+  for (int i = 0; i < errors; i++) {
+    forward();
+    traced += !cdk_errno->no_trace;
+  }
+
+  return traced;
+}
+
+void test_zeroed_sampler_traces_all(void) {
+  TEST_ASSERT_EQUAL(10, traced_of(10));
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+}
+
+void test_sample_every(void) {
+  cdk_error_sample_every(4);
+  TEST_ASSERT_EQUAL(3, traced_of(12));
+
+  cdk_error_sample_every(1);
+  TEST_ASSERT_EQUAL(5, traced_of(5));
+}
+
+void test_first_error_is_traced(void) {
+  cdk_error_sample_every(100);
+  forward();
+  TEST_ASSERT_FALSE(cdk_errno->no_trace);
+  forward();
+  TEST_ASSERT_TRUE(cdk_errno->no_trace);
+}
+
+void test_unsampled_error_keeps_origin(void) {
+  cdk_error_sample_every(2);
+  forward();
+  forward();
+  cdk_ewrap();
+
+  TEST_ASSERT_TRUE(cdk_errno->no_trace);
+  TEST_ASSERT_EQUAL(EIO, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Device failed", cdk_errno->msg);
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL_STRING("failing", cdk_errno->eframes[0].func);
+}
+
+void test_sample_rate_burst(void) {
+  cdk_error_sample_rate(1, 3);
+  TEST_ASSERT_EQUAL(3, traced_of(10));
+}
+
+void test_sample_rate_refills(void) {
+  cdk_error_sample_rate(1, 1);
+  TEST_ASSERT_EQUAL(1, traced_of(3));
+
+  // One second later the bucket holds a token again.
+  cdk_hidden_esampler.last_ns -= 1000000000u;
+  TEST_ASSERT_EQUAL(1, traced_of(3));
+}
+
+void test_sample_rate_refills_after_long_idle(void) {
+  cdk_error_sample_rate(1000, 1);
+  TEST_ASSERT_EQUAL(1, traced_of(1));
+
+  // About 213 days, unclamped refill wraps to a few hundred.
+  cdk_hidden_esampler.last_ns -= 18446744073709552u;
+  TEST_ASSERT_EQUAL(1, traced_of(1));
+}
+
+void test_sample_every_and_rate(void) {
+  cdk_error_sample_every(2);
+  cdk_error_sample_rate(1, 2);
+  TEST_ASSERT_EQUAL(2, traced_of(10));
+}
+
+void test_dump_unsampled_error(void) {
+  char buf[1024];
+
+  cdk_error_sample_every(2);
+  forward();
+  forward();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING("====== ERROR DUMP ======\n"
+                           "Error code: 5\n"
+                           "Error desc: Input/output error\n"
+                           "------------------------\n"
+                           " Error msg: Device failed\n"
+                           "------------------------\n"
+                           " Backtrace:\n"
+                           "   [00] test_cdk_errno_sample.c:failing:19\n",
+                           buf);
+}
+
+void test_promotion_takes_no_sample(void) {
+  cdk_error_sample_every(2);
+
+  cdk_errno = cdk_error_statics(EAGAIN, "Queue full");
+  cdk_ewrap();
+  TEST_ASSERT_FALSE(cdk_errno->no_trace);
+
+  forward(); // Still the first sampled error
+  TEST_ASSERT_FALSE(cdk_errno->no_trace);
+  forward();
+  TEST_ASSERT_TRUE(cdk_errno->no_trace);
+}
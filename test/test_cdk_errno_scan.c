@@ -0,0 +1,113 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+#define STATUS_LEN 100
+
+static int32_t status[STATUS_LEN];
+
+void setUp(void) {
+  for (int32_t i = 0; i < STATUS_LEN; i++) {
+    status[i] = i;
+  }
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static void check_kernel(size_t (*scan)(const int32_t *, size_t)) {
+  TEST_ASSERT_EQUAL(0, scan(status, 0));
+  TEST_ASSERT_EQUAL(STATUS_LEN, scan(status, STATUS_LEN));
+
+  for (size_t fail = 0; fail < STATUS_LEN; fail++) {
+    status[fail] = -EIO;
+    for (size_t len = 0; len <= STATUS_LEN; len++) {
+      TEST_ASSERT_EQUAL(fail < len ? fail : len, scan(status, len));
+    }
+    // Later failures never hide the first one.
+    status[STATUS_LEN - 1] = INT32_MIN;
+    TEST_ASSERT_EQUAL(fail, scan(status, STATUS_LEN));
+    status[STATUS_LEN - 1] = STATUS_LEN - 1;
+    status[fail] = fail;
+  }
+}
+
+static size_t scan_scalar(const int32_t *st, size_t len) {
+  return cdk_escan_scalar(st, 0, len);
+}
+
+void test_scalar_kernel(void) { check_kernel(scan_scalar); }
+
+void test_dispatched_kernel(void) { check_kernel(cdk_error_scan_first); }
+
+#if defined(CDK_ESCAN_X86_) && defined(__SSE2__)
+void test_sse2_kernel(void) { check_kernel(cdk_escan_sse2); }
+#endif
+
+#ifdef CDK_ESCAN_X86_
+void test_avx2_kernel(void) {
+  if (!__builtin_cpu_supports("avx2")) {
+    TEST_IGNORE_MESSAGE("CPU without AVX2");
+  }
+  check_kernel(cdk_escan_avx2);
+}
+#endif
+
+void test_check_without_failure(void) {
+  TEST_ASSERT_NULL(cdk_echeck(status, STATUS_LEN));
+  TEST_ASSERT_EQUAL(0, cdk_hidden_errno.eframes_len);
+}
+
+void test_check_creates_error(void) {
+  char buf[1024];
+
+  status[42] = -EAGAIN;
+  status[77] = -EIO;
+  cdk_errno = cdk_echeck(status, STATUS_LEN);
+
+  TEST_ASSERT_NOT_NULL(cdk_errno);
+  TEST_ASSERT_EQUAL(EAGAIN, cdk_errno->code);
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 11\n"
+      "Error desc: Resource temporarily unavailable\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_scan.c:test_check_creates_error:71\n",
+      buf);
+}
+
+void test_check_clamps_code(void) {
+  status[0] = INT32_MIN;
+  cdk_errno = cdk_echeck(status, STATUS_LEN);
+  TEST_ASSERT_EQUAL(UINT16_MAX, cdk_errno->code);
+}
+
+void test_check_all_into_batch(void) {
+  static _Alignas(8) char storage[64 * CDK_EBATCH_ENTRY_SIZE];
+  struct cdk_EBatch batch;
+
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_init(&batch, storage, sizeof(storage)));
+  TEST_ASSERT_EQUAL(0, cdk_error_check_all(&batch, status, STATUS_LEN, 1000));
+
+  status[0] = -EINVAL;
+  status[31] = -EIO;
+  status[32] = -EIO;
+  status[99] = -ENOMEM;
+  TEST_ASSERT_EQUAL(4, cdk_error_check_all(&batch, status, STATUS_LEN, 1000));
+
+  TEST_ASSERT_EQUAL(4, batch.len);
+  TEST_ASSERT_EQUAL(1000, batch.items[0]);
+  TEST_ASSERT_EQUAL(EINVAL, batch.codes[0]);
+  TEST_ASSERT_EQUAL(1031, batch.items[1]);
+  TEST_ASSERT_EQUAL(1032, batch.items[2]);
+  TEST_ASSERT_EQUAL(1099, batch.items[3]);
+  TEST_ASSERT_EQUAL(ENOMEM, batch.codes[3]);
+  TEST_ASSERT_EQUAL(2, cdk_error_batch_count(&batch, EIO));
+}
@@ -0,0 +1,101 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+static int failing_func(void) {
+  cdk_errno = cdk_errnos(EINVAL, "Invalid user input");
+  return cdk_ereturn(-1);
+}
+
+void test_encode_decode_roundtrip(void) {
+  struct cdk_EDecoded dec;
+  struct cdk_EFrameView frame;
+  uint8_t buf[512];
+  size_t len;
+
+  failing_func();
+  TEST_ASSERT_EQUAL(0, cdk_eencode(sizeof(buf), buf, &len));
+  TEST_ASSERT_EQUAL(0, cdk_error_decode(len, buf, &dec));
+
+  TEST_ASSERT_EQUAL(len, dec.size);
+  TEST_ASSERT_EQUAL(CDK_ERROR_ENCODING_VERSION, dec.version);
+  TEST_ASSERT_EQUAL(cdk_EncodedType_STR, dec.type);
+  TEST_ASSERT_EQUAL(EINVAL, dec.code);
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, dec.btrace_max);
+  TEST_ASSERT_EQUAL(CDK_ERROR_FSTR_MAX, dec.fstr_max);
+  TEST_ASSERT_EQUAL(2, dec.eframes_len);
+
+  TEST_ASSERT_TRUE(dec.msg.ptr >= (const char *)buf &&
+                   dec.msg.ptr < (const char *)buf + len);
+  TEST_ASSERT_EQUAL(strlen("Invalid user input"), dec.msg.len);
+  TEST_ASSERT_EQUAL_MEMORY("Invalid user input", dec.msg.ptr, dec.msg.len);
+
+  const uint8_t *pos = cdk_error_decode_frame(&dec, dec.eframes, &frame);
+#ifdef CDK_ERROR_SITE_IDS
+  TEST_ASSERT_EQUAL(cdk_errno->eframes[0].site, frame.site);
+#else
+  TEST_ASSERT_EQUAL(11, frame.line);
+  TEST_ASSERT_EQUAL_MEMORY("test_cdk_errno_serialize.c", frame.file.ptr,
+                           frame.file.len);
+  TEST_ASSERT_EQUAL_MEMORY("failing_func", frame.func.ptr, frame.func.len);
+#endif
+
+  pos = cdk_error_decode_frame(&dec, pos, &frame);
+#ifdef CDK_ERROR_SITE_IDS
+  TEST_ASSERT_EQUAL(cdk_errno->eframes[1].site, frame.site);
+#else
+  TEST_ASSERT_EQUAL(12, frame.line);
+#endif
+  TEST_ASSERT_EQUAL_PTR(buf + len, pos);
+}
+
+void test_integer_error_has_no_message(void) {
+  struct cdk_EDecoded dec;
+  uint8_t buf[512];
+  size_t len;
+
+  cdk_errno = cdk_errnoi(ENOMEM);
+  TEST_ASSERT_EQUAL(0, cdk_eencode(sizeof(buf), buf, &len));
+  TEST_ASSERT_EQUAL(0, cdk_error_decode(len, buf, &dec));
+
+  TEST_ASSERT_EQUAL(cdk_EncodedType_INT, dec.type);
+  TEST_ASSERT_NULL(dec.msg.ptr);
+  TEST_ASSERT_EQUAL(0, dec.msg.len);
+  TEST_ASSERT_EQUAL(1, dec.eframes_len);
+}
+
+void test_encode_too_small_buffer(void) {
+  uint8_t buf[512];
+  size_t len;
+
+  failing_func();
+  TEST_ASSERT_EQUAL(0, cdk_eencode(sizeof(buf), buf, &len));
+
+  for (size_t size = 0; size < len; size++) {
+    TEST_ASSERT_EQUAL(ENOBUFS, cdk_eencode(size, buf, &len));
+  }
+}
+
+void test_decode_rejects_malformed_input(void) {
+  struct cdk_EDecoded dec;
+  uint8_t buf[512];
+  size_t len;
+
+  failing_func();
+  TEST_ASSERT_EQUAL(0, cdk_eencode(sizeof(buf), buf, &len));
+
+  for (size_t size = 0; size < len; size++) {
+    TEST_ASSERT_EQUAL(EBADMSG, cdk_error_decode(size, buf, &dec));
+  }
+
+  buf[2] = CDK_ERROR_ENCODING_VERSION + 1;
+  TEST_ASSERT_EQUAL(ENOTSUP, cdk_error_decode(len, buf, &dec));
+
+  buf[0] = 'x';
+  TEST_ASSERT_EQUAL(EBADMSG, cdk_error_decode(len, buf, &dec));
+}
@@ -0,0 +1,149 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+_Thread_local struct cdk_EShadow cdk_hidden_eshadow = {0};
+#ifdef CDK_ERROR_DEPTH
+_Thread_local size_t cdk_hidden_edepth = 0;
+#endif
+
+void setUp(void) {
+  cdk_hidden_eshadow.len = 0;
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static int read_block(void) {
+  CDK_FUNC_ENTER();
+  cdk_errno = cdk_errnoi(EIO);
+  return -1;
+}
+
+static int read_file(void) {
+  CDK_FUNC_ENTER();
+  return read_block();
+}
+
+static int load_config(void) {
+  CDK_FUNC_ENTER();
+  if (read_file()) {
+    return -1; // No wrap, shadow stack already holds this frame
+  }
+  return 0;
+}
+
+static int recurse(int depth) {
+  CDK_FUNC_ENTER();
+  if (depth == 0) {
+    return read_block();
+  }
+  return recurse(depth - 1);
+}
+
+static int load_deep(void) {
+  CDK_FUNC_ENTER();
+  return recurse(2 * CDK_ERROR_BTRACE_MAX);
+}
+
+static jmp_buf jump;
+
+static void jump_out(void) {
+  CDK_FUNC_ENTER();
+  longjmp(jump, 1);
+}
+
+static void catch_jump(void) {
+  CDK_FUNC_ENTER();
+  if (!setjmp(jump)) {
+    jump_out();
+  }
+}
+
+void test_functions_pop_on_return(void) {
+  load_config();
+  TEST_ASSERT_EQUAL(0, cdk_hidden_eshadow.len);
+
+  {
+    CDK_FUNC_ENTER();
+    TEST_ASSERT_EQUAL(1, cdk_hidden_eshadow.len);
+  }
+  TEST_ASSERT_EQUAL(0, cdk_hidden_eshadow.len);
+}
+
+void test_error_copies_shadow_stack(void) {
+  char buf[1024];
+
+  load_config();
+
+  TEST_ASSERT_EQUAL(3, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING("====== ERROR DUMP ======\n"
+                           "Error code: 5\n"
+                           "Error desc: Input/output error\n"
+                           "------------------------\n"
+                           " Backtrace:\n"
+                           "   [00] test_cdk_errno_shadow.c:read_block:24\n"
+                           "   [01] test_cdk_errno_shadow.c:read_file:29\n"
+                           "   [02] test_cdk_errno_shadow.c:load_config:34\n",
+                           buf);
+}
+
+void test_deep_stack_keeps_head_and_tail(void) {
+  load_deep();
+
+  // Origin, 2 * CDK_ERROR_BTRACE_MAX + 1 recurse frames and load_deep.
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX + 3, cdk_errno->eframes_dropped);
+  TEST_ASSERT_EQUAL_STRING("read_block", cdk_errno->eframes[0].func);
+  TEST_ASSERT_EQUAL_STRING("recurse", cdk_errno->eframes[1].func);
+  TEST_ASSERT_EQUAL_STRING("load_deep", cdk_error_last_frame(cdk_errno)->func);
+  TEST_ASSERT_EQUAL(0, cdk_hidden_eshadow.len);
+}
+
+void test_stack_deeper_than_shadow_max(void) {
+  recurse(CDK_ERROR_SHADOW_MAX + 5);
+
+  // Only the outermost CDK_ERROR_SHADOW_MAX calls were recorded.
+  TEST_ASSERT_EQUAL(CDK_ERROR_BTRACE_MAX, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(CDK_ERROR_SHADOW_MAX + 1 - CDK_ERROR_BTRACE_MAX,
+                    cdk_errno->eframes_dropped);
+  TEST_ASSERT_EQUAL_STRING("recurse", cdk_errno->eframes[1].func);
+}
+
+void test_longjmp_is_repaired_by_caller(void) {
+  catch_jump();
+
+  TEST_ASSERT_EQUAL(0, cdk_hidden_eshadow.len);
+}
+
+void test_batch_entry_has_no_shadow_frames(void) {
+  static _Alignas(8) char storage[8 * CDK_EBATCH_ENTRY_SIZE];
+  struct cdk_EBatch batch;
+
+  TEST_ASSERT_EQUAL(0, cdk_error_batch_init(&batch, storage, sizeof(storage)));
+  cdk_error_batch_add(&batch, 3, EINVAL, NULL);
+
+  CDK_FUNC_ENTER();
+  cdk_errno = cdk_ebatch_get(&batch, 0);
+
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL_STRING("test_batch_entry_has_no_shadow_frames",
+                           cdk_errno->eframes[0].func);
+}
+
+void test_depth_limit_applies(void) {
+#ifdef CDK_ERROR_DEPTH
+  cdk_error_depth_set(2);
+  load_config();
+  cdk_error_depth_set(CDK_ERROR_BTRACE_MAX);
+
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_dropped);
+#endif
+}
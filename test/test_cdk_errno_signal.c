@@ -0,0 +1,88 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+static int dump_fd = -1;
+static volatile sig_atomic_t dump_ret = -1;
+
+static void crash_handler(int signum) {
+  (void)signum;
+  dump_ret = cdk_edumpfd(dump_fd);
+}
+
+static void dump_in_signal_handler(char *buf, size_t buf_size) {
+  struct sigaction action = {.sa_handler = crash_handler};
+  struct sigaction old_action;
+  int pipe_fds[2];
+  size_t len = 0;
+  ssize_t ret;
+
+  TEST_ASSERT_EQUAL(0, pipe(pipe_fds));
+  TEST_ASSERT_EQUAL(0, sigaction(SIGUSR1, &action, &old_action));
+
+  dump_fd = pipe_fds[1];
+  dump_ret = -1;
+  errno = EAGAIN;
+  raise(SIGUSR1);
+  TEST_ASSERT_EQUAL(EAGAIN, errno);
+  TEST_ASSERT_EQUAL(0, dump_ret);
+
+  close(pipe_fds[1]);
+  while ((ret = read(pipe_fds[0], buf + len, buf_size - 1 - len)) > 0) {
+    len += ret;
+  }
+  buf[len] = 0;
+  close(pipe_fds[0]);
+
+  sigaction(SIGUSR1, &old_action, NULL);
+}
+
+static int failing_func(void) {
+  cdk_errno = cdk_errnos(EINVAL, "Invalid user input");
+  return cdk_ereturn(-1);
+}
+
+void test_signal_dump_matches_dumps(void) {
+  char expected[4096];
+  char buf[4096];
+
+  failing_func();
+  for (int i = 0; i < CDK_ERROR_BTRACE_MAX; i++) {
+    cdk_ewrap();
+  }
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(expected), expected));
+  TEST_ASSERT_GREATER_THAN(256, strlen(expected));
+
+  dump_in_signal_handler(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_signal_dump_of_half_written_error(void) {
+  char buf[8192];
+
+  failing_func();
+  cdk_hidden_errno.eframes_len = CDK_ERROR_BTRACE_MAX + 100;
+
+  dump_in_signal_handler(buf, sizeof(buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, " Error msg: Invalid user input\n"));
+
+  char last_frame[16];
+  snprintf(last_frame, sizeof(last_frame), "[%02d]", CDK_ERROR_BTRACE_MAX - 1);
+  TEST_ASSERT_NOT_NULL(strstr(buf, last_frame));
+  snprintf(last_frame, sizeof(last_frame), "[%02d]", CDK_ERROR_BTRACE_MAX);
+  TEST_ASSERT_NULL(strstr(buf, last_frame));
+}
+
+void test_dump_to_closed_fd(void) {
+  failing_func();
+  TEST_ASSERT_EQUAL(EIO, cdk_edumpfd(-1));
+}
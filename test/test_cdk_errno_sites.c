@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+void test_frame_holds_only_site_id(void) {
+  TEST_ASSERT_EQUAL(sizeof(cdk_esite_id_t), sizeof(struct cdk_EFrame));
+}
+
+void test_sites_resolve(void) {
+  cdk_errno = cdk_errnoi(EINVAL);
+  cdk_ewrap();
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+
+  struct cdk_ESite site = cdk_eframe_site(&cdk_errno->eframes[0]);
+  TEST_ASSERT_EQUAL_STRING("test_cdk_errno_sites.c", site.file);
+  TEST_ASSERT_EQUAL_STRING("test_sites_resolve", site.func);
+  TEST_ASSERT_EQUAL(15, site.line);
+
+  site = cdk_eframe_site(&cdk_errno->eframes[1]);
+  TEST_ASSERT_EQUAL_STRING("test_sites_resolve", site.func);
+  TEST_ASSERT_EQUAL(16, site.line);
+
+  TEST_ASSERT_NOT_EQUAL(cdk_errno->eframes[0].site,
+                        cdk_errno->eframes[1].site);
+}
+
+void test_same_site_same_id(void) {
+  cdk_esite_id_t ids[2];
+  for (int i = 0; i < 2; i++) {
+    cdk_errno = cdk_errnos(EINVAL, "Loop error");
+    ids[i] = cdk_errno->eframes[0].site;
+  }
+
+  TEST_ASSERT_EQUAL(ids[0], ids[1]);
+}
+
+void test_sites_dump_to_str(void) {
+  char buf[4096];
+  char expected[256];
+
+  cdk_errno = cdk_errnoi(EINVAL);
+  TEST_ASSERT_EQUAL(0, cdk_error_sites_dumps(sizeof(buf), buf));
+
+  snprintf(expected, sizeof(expected),
+           "%u test_cdk_errno_sites.c:test_sites_dump_to_str:46\n",
+           cdk_errno->eframes[0].site);
+  TEST_ASSERT_NOT_NULL(strstr(buf, expected));
+
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_error_sites_dumps(8, buf));
+}
+
+void test_error_dump_to_str(void) {
+  char buf[1024];
+
+  cdk_errno = cdk_errnos(200, "Format error");
+  cdk_ewrap();
+  cdk_edumps(sizeof(buf), buf);
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 200\n"
+      "Error desc: Unknown error 200\n"
+      "------------------------\n"
+      " Error msg: Format error\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_sites.c:test_error_dump_to_str:60\n"
+      "   [01] test_cdk_errno_sites.c:test_error_dump_to_str:61\n",
+      buf);
+}
+
+void test_error_keeps_site_table(void) {
+  char buf[1024];
+  char expected[64];
+  struct cdk_ESite other[64];
+
+  // Table of another object, where every id means a different site.
+  for (size_t i = 0; i < sizeof(other) / sizeof(other[0]); i++) {
+    other[i] = (struct cdk_ESite){.file = "lib.c", .func = "lib_open",
+                                  .line = (uint32_t)i};
+  }
+
+  cdk_errno = cdk_errnoi(EIO);
+  TEST_ASSERT_EQUAL_PTR(__start_cdk_esites, cdk_errno->esites);
+  TEST_ASSERT_LESS_THAN(64, cdk_errno->eframes[0].site);
+  cdk_errno->esites = other;
+  cdk_ewrap(); // Id of this object's table would be misread, it is skipped
+
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  snprintf(expected, sizeof(expected), "   [00] lib.c:lib_open:%u\n",
+           cdk_errno->eframes[0].site);
+  TEST_ASSERT_NOT_NULL(strstr(buf, expected));
+}
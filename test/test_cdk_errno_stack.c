@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+_Thread_local struct cdk_EStack cdk_hidden_estack = {0};
+
+void setUp(void) {
+  cdk_hidden_errno = (struct cdk_Error){0};
+  cdk_hidden_estack = (struct cdk_EStack){0};
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static int failing_func(void) {
+  cdk_errno = cdk_errnos(EINVAL, "Invalid user input");
+  return cdk_ereturn(-1);
+}
+
+static int failing_cleanup(void) {
+  cdk_errno = cdk_errnoi(ENOMEM);
+  return cdk_ereturn(-1);
+}
+
+void test_cleanup_does_not_clobber_error(void) {
+  failing_func();
+  cdk_error_t handled = cdk_errno;
+
+  TEST_ASSERT_EQUAL(0, cdk_epush());
+  TEST_ASSERT_NULL(cdk_errno);
+  failing_cleanup();
+  TEST_ASSERT_EQUAL(ENOMEM, cdk_errno->code);
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_estack.slots[0], cdk_errno);
+  TEST_ASSERT_EQUAL(0, cdk_epop());
+
+  TEST_ASSERT_EQUAL_PTR(handled, cdk_errno);
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_errno, cdk_errno);
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Invalid user input", cdk_errno->msg);
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+}
+
+void test_nested_levels(void) {
+  failing_func();
+
+  cdk_epush();
+  failing_cleanup();
+  cdk_epush();
+  cdk_errno = cdk_errnoi(EIO);
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_estack.slots[1], cdk_errno);
+
+  cdk_epop();
+  TEST_ASSERT_EQUAL(ENOMEM, cdk_errno->code);
+  cdk_epop();
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+}
+
+void test_push_without_error(void) {
+  cdk_epush();
+  cdk_epop();
+  TEST_ASSERT_NULL(cdk_errno);
+}
+
+void test_overflow_and_underflow(void) {
+  failing_func();
+
+  for (int i = 0; i < CDK_ERROR_STACK_MAX; i++) {
+    TEST_ASSERT_EQUAL(0, cdk_epush());
+  }
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_epush());
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_epop());
+  for (int i = 0; i < CDK_ERROR_STACK_MAX; i++) {
+    TEST_ASSERT_EQUAL(0, cdk_epop());
+  }
+  TEST_ASSERT_EQUAL(EINVAL, cdk_epop());
+
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+  TEST_ASSERT_EQUAL(1, cdk_hidden_estack.dropped);
+}
+
+void test_refused_push_keeps_deepest_error(void) {
+  for (int i = 0; i < CDK_ERROR_STACK_MAX; i++) {
+    cdk_epush();
+  }
+  failing_func();
+  cdk_error_t handled = cdk_errno;
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_estack.slots[CDK_ERROR_STACK_MAX - 1],
+                        handled);
+
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_epush());
+  TEST_ASSERT_NULL(cdk_errno);
+  failing_cleanup();
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_estack.spill, cdk_errno);
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_epush());
+  cdk_errno = cdk_errnoi(EIO);
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_epop());
+  TEST_ASSERT_NULL(cdk_errno); // ENOMEM shared the spill slot, it is lost
+  TEST_ASSERT_EQUAL(ENOBUFS, cdk_epop());
+
+  TEST_ASSERT_EQUAL_PTR(handled, cdk_errno);
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Invalid user input", cdk_errno->msg);
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL(2, cdk_hidden_estack.dropped);
+
+  // New errors go to the deepest slot again.
+  cdk_errno = cdk_errnoi(EIO);
+  TEST_ASSERT_EQUAL_PTR(handled, cdk_errno);
+}
+
+void test_wrap_after_pop_extends_original(void) {
+  char buf[1024];
+
+  failing_func();
+  cdk_epush();
+  failing_cleanup();
+  cdk_epop();
+  cdk_ewrap();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 22\n"
+      "Error desc: Invalid argument\n"
+      "------------------------\n"
+      " Error msg: Invalid user input\n"
+      "------------------------\n"
+      " Backtrace:\n"
+      "   [00] test_cdk_errno_stack.c:failing_func:20\n"
+      "   [01] test_cdk_errno_stack.c:failing_func:21\n"
+      "   [02] test_cdk_errno_stack.c:test_wrap_after_pop_extends_original:"
+      "122\n",
+      buf);
+}
@@ -0,0 +1,127 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+
+void setUp(void) {
+  cdk_hidden_errno = (struct cdk_Error){0};
+  cdk_errno = NULL;
+}
+
+void tearDown(void) {}
+
+static cdk_error_t out_of_memory(void) { return cdk_error_statici(ENOMEM); }
+
+static int backpressure(void) {
+  cdk_errno = cdk_error_statics(EAGAIN, "Queue full");
+  return -1;
+}
+
+static int forward(void) {
+  if (backpressure()) {
+    return cdk_ereturn(-1);
+  }
+  return 0;
+}
+
+void test_same_object_every_time(void) {
+  cdk_error_t err = out_of_memory();
+
+  TEST_ASSERT_EQUAL_PTR(err, out_of_memory());
+  TEST_ASSERT_TRUE(err->shared);
+  TEST_ASSERT_EQUAL(cdk_ErrorType_INT, err->type);
+  TEST_ASSERT_EQUAL(ENOMEM, err->code);
+  TEST_ASSERT_NULL(err->msg);
+  TEST_ASSERT_EQUAL(0, cdk_hidden_errno.eframes_len);
+}
+
+void test_static_error_origin(void) {
+  backpressure();
+
+  TEST_ASSERT_EQUAL(cdk_ErrorType_STR, cdk_errno->type);
+  TEST_ASSERT_EQUAL(EAGAIN, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Queue full", cdk_errno->msg);
+#ifdef CDK_ERROR_SITE_IDS
+  TEST_ASSERT_EQUAL(0, cdk_errno->eframes_len);
+#else
+  TEST_ASSERT_EQUAL(1, cdk_errno->eframes_len);
+  TEST_ASSERT_EQUAL_STRING("backpressure", cdk_errno->eframes[0].func);
+  TEST_ASSERT_EQUAL(20, cdk_errno->eframes[0].line);
+#endif
+}
+
+void test_promote_leaves_other_errors(void) {
+  struct cdk_Error slot = {0};
+  cdk_error_t err = cdk_errori(&slot, EIO);
+
+  TEST_ASSERT_EQUAL_PTR(err, cdk_error_promote(err, &cdk_hidden_errno));
+  TEST_ASSERT_EQUAL(0, cdk_hidden_errno.eframes_len);
+
+  err = cdk_error_promote(out_of_memory(), &slot);
+  TEST_ASSERT_EQUAL_PTR(&slot, err);
+  TEST_ASSERT_FALSE(err->shared);
+  TEST_ASSERT_EQUAL(ENOMEM, err->code);
+}
+
+void test_generic_wrap_skips_static(void) {
+  cdk_error_t err = out_of_memory();
+  size_t eframes_len = err->eframes_len;
+
+  cdk_error_wrap(err);
+  TEST_ASSERT_EQUAL(eframes_len, err->eframes_len);
+}
+
+void test_wrap_promotes_to_thread_slot(void) {
+  cdk_error_t shared;
+
+  TEST_ASSERT_EQUAL(-1, forward());
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_errno, cdk_errno);
+  TEST_ASSERT_FALSE(cdk_errno->shared);
+
+  // Shared object is not touched by the wrap.
+  backpressure();
+  shared = cdk_errno;
+  TEST_ASSERT_EQUAL(cdk_hidden_errno.eframes_len - 1, shared->eframes_len);
+}
+
+void test_dump_static_error(void) {
+  char buf[1024];
+
+  backpressure();
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, " Error msg: Queue full\n"));
+
+  cdk_errno = out_of_memory();
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_NOT_NULL(strstr(buf, "Error code: 12\n"));
+}
+
+void test_dump_promoted_error(void) {
+  char buf[1024];
+
+  forward();
+  cdk_ewrap();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "====== ERROR DUMP ======\n"
+      "Error code: 11\n"
+      "Error desc: Resource temporarily unavailable\n"
+      "------------------------\n"
+      " Error msg: Queue full\n"
+      "------------------------\n"
+      " Backtrace:\n"
+#ifndef CDK_ERROR_SITE_IDS
+      "   [00] test_cdk_errno_static.c:backpressure:20\n"
+      "   [01] test_cdk_errno_static.c:forward:26\n"
+      "   [02] test_cdk_errno_static.c:test_dump_promoted_error:107\n",
+#else
+      "   [00] test_cdk_errno_static.c:forward:26\n"
+      "   [01] test_cdk_errno_static.c:test_dump_promoted_error:107\n",
+#endif
+      buf);
+}
@@ -0,0 +1,80 @@
+#include <errno.h>
+#include <string.h>
+#include <threads.h>
+
+#include "cdk_error.h"
+#include "unity.h"
+
+#ifdef CDK_ERROR_TLS_BLOCK
+_Thread_local struct cdk_ETls cdk_hidden_etls = {0};
+
+#ifdef CDK_ERROR_TLS_ACCESSOR
+struct cdk_ETls *cdk_etls_location(void) { return &cdk_hidden_etls; }
+#endif
+#else
+_Thread_local cdk_error_t cdk_errno = NULL;
+_Thread_local struct cdk_Error cdk_hidden_errno = {0};
+#endif
+
+void setUp(void) { cdk_errno = NULL; }
+
+void tearDown(void) {}
+
+static int read_block(void) {
+  cdk_errno = cdk_errnoi(EIO);
+  return -1;
+}
+
+static int read_file(void) {
+  if (read_block()) {
+    return cdk_ereturn(-1);
+  }
+  return 0;
+}
+
+static int thread_main(void *arg) {
+  (void)arg;
+  return cdk_errno == NULL && read_file() && cdk_errno->code == EIO
+             ? (int)cdk_errno->eframes_len
+             : -1;
+}
+
+void test_slots_are_shared_by_errno_api(void) {
+  read_file();
+
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_errno, cdk_errno);
+  TEST_ASSERT_EQUAL(EIO, cdk_errno->code);
+  TEST_ASSERT_EQUAL(2, cdk_errno->eframes_len);
+#ifdef CDK_ERROR_TLS_BLOCK
+  TEST_ASSERT_EQUAL_PTR(&cdk_hidden_etls.slot, cdk_errno);
+#endif
+}
+
+void test_slots_are_per_thread(void) {
+  thrd_t thread;
+  int frames;
+
+  cdk_errno = cdk_errnos(EINVAL, "Main thread");
+
+  TEST_ASSERT_EQUAL(thrd_success, thrd_create(&thread, thread_main, NULL));
+  TEST_ASSERT_EQUAL(thrd_success, thrd_join(thread, &frames));
+  TEST_ASSERT_EQUAL(2, frames);
+  TEST_ASSERT_EQUAL(EINVAL, cdk_errno->code);
+  TEST_ASSERT_EQUAL_STRING("Main thread", cdk_errno->msg);
+}
+
+void test_dump_through_slots(void) {
+  char buf[1024];
+
+  read_file();
+
+  TEST_ASSERT_EQUAL(0, cdk_edumps(sizeof(buf), buf));
+  TEST_ASSERT_EQUAL_STRING("====== ERROR DUMP ======\n"
+                           "Error code: 5\n"
+                           "Error desc: Input/output error\n"
+                           "------------------------\n"
+                           " Backtrace:\n"
+                           "   [00] test_cdk_errno_tls.c:read_block:24\n"
+                           "   [01] test_cdk_errno_tls.c:read_file:30\n",
+                           buf);
+}
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+Export call site table of a binary built with CDK_ERROR_SITE_IDS.
+
+Output matches cdk_error_sites_dumps, one `id file:func:line` per line, so
+logs carrying only site ids can be decoded without running the binary. Pass
+`--prefix` for headers renamed with change_prefix.py.
+"""
+import argparse
+import struct
+import sys
+
+PREFIX = "cdk"
+
+# Relocation types which store `base + addend`, used by PIE and shared objects.
+RELATIVE_RELOCS = {
+    3: 8,  # EM_386: R_386_RELATIVE
+    62: 8,  # EM_X86_64: R_X86_64_RELATIVE
+    40: 23,  # EM_ARM: R_ARM_RELATIVE
+    183: 1027,  # EM_AARCH64: R_AARCH64_RELATIVE
+    243: 3,  # EM_RISCV: R_RISCV_RELATIVE
+}
+
+SHT_RELA = 4
+SHT_REL = 9
+
+
+class Elf:
+    def __init__(self, data):
+        if data[:4] != b"\x7fELF":
+            raise ValueError("not an ELF file")
+
+        self.data = data
+        self.is64 = data[4] == 2
+        self.end = "<" if data[5] == 1 else ">"
+        self.ptr = "Q" if self.is64 else "I"
+        self.ptr_size = 8 if self.is64 else 4
+
+        if self.is64:
+            hdr = struct.unpack_from(self.end + "HHIQQQIHHHHHH", data, 16)
+            _, self.machine, _, _, _, shoff, _, _, _, _, shentsize, shnum, shstrndx = hdr
+        else:
+            hdr = struct.unpack_from(self.end + "HHIIIIIHHHHHH", data, 16)
+            _, self.machine, _, _, _, shoff, _, _, _, _, shentsize, shnum, shstrndx = hdr
+
+        self.sections = []
+        for i in range(shnum):
+            off = shoff + i * shentsize
+            if self.is64:
+                fields = struct.unpack_from(self.end + "IIQQQQIIQQ", data, off)
+            else:
+                fields = struct.unpack_from(self.end + "IIIIIIIIII", data, off)
+            name, type_, _, addr, offset, size, _, _, _, entsize = fields
+            self.sections.append(
+                {"name": name, "type": type_, "addr": addr, "offset": offset,
+                 "size": size, "entsize": entsize}
+            )
+
+        strtab = self.sections[shstrndx]
+        for sec in self.sections:
+            sec["name"] = self.cstr(strtab["offset"] + sec["name"])
+
+    def cstr(self, offset):
+        return self.data[offset:self.data.index(b"\0", offset)].decode()
+
+    def section(self, name):
+        for sec in self.sections:
+            if sec["name"] == name:
+                return sec
+        return None
+
+    def addr_to_offset(self, addr):
+        for sec in self.sections:
+            if sec["addr"] and sec["addr"] <= addr < sec["addr"] + sec["size"]:
+                return sec["offset"] + addr - sec["addr"]
+        raise ValueError(f"address {addr:#x} not mapped by any section")
+
+    def relative_addends(self):
+        """Map of relocated address -> value for RELATIVE relocations."""
+        rtype = RELATIVE_RELOCS.get(self.machine)
+        addends = {}
+        if rtype is None:
+            return addends
+
+        for sec in self.sections:
+            if sec["type"] not in (SHT_RELA, SHT_REL) or not sec["entsize"]:
+                continue
+            is_rela = sec["type"] == SHT_RELA
+            fmt = self.end + self.ptr * (3 if is_rela else 2)
+            for off in range(sec["offset"], sec["offset"] + sec["size"], sec["entsize"]):
+                entry = struct.unpack_from(fmt, self.data, off)
+                info = entry[1]
+                if (info & 0xFFFFFFFF if self.is64 else info & 0xFF) != rtype:
+                    continue
+                if is_rela:
+                    addends[entry[0]] = entry[2]
+                else:
+                    addends[entry[0]] = struct.unpack_from(
+                        self.end + self.ptr, self.data, self.addr_to_offset(entry[0])
+                    )[0]
+        return addends
+
+
+def section_name(prefix):
+    """Site section of a header whose `cdk` prefix was renamed to prefix."""
+    return prefix.lower() + "_esites"
+
+
+def export_sites(path, prefix=PREFIX):
+    with open(path, "rb") as f:
+        elf = Elf(f.read())
+
+    sec = elf.section(section_name(prefix))
+    if sec is None:
+        return []
+
+    # struct cdk_ESite { const char *file; const char *func; uint32_t line; }
+    site_size = 3 * elf.ptr_size
+    addends = elf.relative_addends()
+
+    def read_ptr(addr):
+        if addr in addends:
+            return addends[addr]
+        return struct.unpack_from(elf.end + elf.ptr, elf.data, elf.addr_to_offset(addr))[0]
+
+    sites = []
+    for i in range(sec["size"] // site_size):
+        addr = sec["addr"] + i * site_size
+        file = elf.cstr(elf.addr_to_offset(read_ptr(addr)))
+        func = elf.cstr(elf.addr_to_offset(read_ptr(addr + elf.ptr_size)))
+        (line,) = struct.unpack_from(
+            elf.end + "I", elf.data, sec["offset"] + i * site_size + 2 * elf.ptr_size
+        )
+        sites.append((i, file, func, line))
+
+    return sites
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export cdk_error site table.")
+
+    parser.add_argument(
+        "--inf",
+        help="Executable or shared object built with CDK_ERROR_SITE_IDS",
+        required=True,
+    )
+    parser.add_argument(
+        "--out",
+        help="Output file, stdout by default",
+    )
+    parser.add_argument(
+        "--prefix",
+        help=f"Prefix the header was renamed to, {PREFIX} by default",
+        default=PREFIX,
+    )
+
+    args = parser.parse_args()
+
+    sites = export_sites(args.inf, args.prefix)
+
+    out = open(args.out, "w") if args.out else sys.stdout
+    for site_id, file, func, line in sites:
+        out.write(f"{site_id} {file}:{func}:{line}\n")
+    if args.out:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""
+Decode a flight recorder file written with CDK_ERROR_FLIGHT.
+
+Prints surviving records oldest first, one
+`seq time thread type code file:func:line` per line. Time is the recorder's
+clock in seconds, sites whose entry was taken by another site read as `?`.
+"""
+import argparse
+import struct
+import sys
+
+MAGIC = b"cdkeflt\0"
+VERSION = 2
+
+# struct cdk_EFlightHeader
+HEADER = "8sIIQQII24x"
+# struct cdk_EFlightRecord
+RECORD = "QQQIHBx"
+# struct cdk_EFlightSite
+SITE = "IIBB2x24s28s"
+
+TYPES = {0: "INT", 1: "STR", 2: "FSTR"}
+
+
+def read_flight(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    for end in "<>":
+        header = struct.unpack_from(end + HEADER, data, 0)
+        if header[0] == MAGIC and header[1] == VERSION:
+            break
+    else:
+        raise ValueError("not a flight recorder file, or unsupported version")
+
+    _, _, record_size, records_len, _, sites_len, site_size = header
+    offset = struct.calcsize(end + HEADER)
+    sites_offset = offset + records_len * record_size
+
+    def read_site(site):
+        hash_, line, file_len, func_len, file, func = struct.unpack_from(
+            end + SITE, data, sites_offset + (site % sites_len) * site_size
+        )
+        # No site, or its entry was taken by another one.
+        if site == 0 or hash_ != site:
+            return "?", "?", "?"
+        return (file[:file_len].decode(errors="replace"),
+                func[:func_len].decode(errors="replace"), line)
+
+    records = []
+    for i in range(records_len):
+        seq, time, thread, site, code, type_ = struct.unpack_from(
+            end + RECORD, data, offset + i * record_size
+        )
+
+        # Empty slot, or a write torn by a crash.
+        if seq == 0 or (seq - 1) % records_len != i:
+            continue
+
+        records.append(
+            (seq - 1, time, thread, TYPES.get(type_, str(type_)), code,
+             *read_site(site))
+        )
+
+    records.sort()
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode cdk_error flight recorder.")
+
+    parser.add_argument(
+        "--inf",
+        help="File passed to cdk_error_flight_open",
+        required=True,
+    )
+    parser.add_argument(
+        "--out",
+        help="Output file, stdout by default",
+    )
+
+    args = parser.parse_args()
+
+    records = read_flight(args.inf)
+
+    out = open(args.out, "w") if args.out else sys.stdout
+    for seq, time, thread, type_, code, file, func, line in records:
+        out.write(
+            f"{seq} {time // 10**9}.{time % 10**9:09d} {thread:#x} {type_} "
+            f"{code} {file}:{func}:{line}\n"
+        )
+    if args.out:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()